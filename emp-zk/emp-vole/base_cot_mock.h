@@ -3,6 +3,7 @@
 
 // Note: emp-tool and OTPre provided via emp-vole-mock.h
 // This file uses preot_blake3.h for OTPre
+#include <atomic>
 
 // Mock BaseCot that doesn't use IKNP/OTCO
 // Uses synchronized PRG for benchmarking only
@@ -17,7 +18,8 @@ public:
     IO *io;
     PRG sync_prg;
     bool malicious = false;
-    static int64_t total_cots;
+    // Atomic: both parties may run in one process (LocalIO)
+    static std::atomic<int64_t> total_cots;
 
     BaseCotMock(int party, IO *io, bool malicious = false) {
         this->party = party;
@@ -77,6 +79,8 @@ public:
 
     // Generate COTs using synchronized PRG
     void cot_gen(block *ot_data, int64_t size, bool *pre_bool = nullptr) {
+        VOLE_PHASE(VOLE_PHASE_COT_GEN);
+        VOLE_COUNT(VOLE_COUNT_COTS, size);
         total_cots += size;
         // Generate synchronized random data
         sync_prg.random_block(ot_data, size);
@@ -111,6 +115,8 @@ public:
     // Alice has: M[i]
     // Bob has: M[i] ^ (choice[i] * Delta)
     void cot_gen(OTPre<IO> *pre_ot, int64_t size, bool *pre_bool = nullptr) {
+        VOLE_PHASE(VOLE_PHASE_COT_GEN);
+        VOLE_COUNT(VOLE_COUNT_COTS, size);
         total_cots += size;
         block *ot_data = new block[size];
         bool *choice = new bool[size];
@@ -141,6 +147,6 @@ public:
 };
 
 template<typename IO>
-int64_t BaseCotMock<IO>::total_cots = 0;
+std::atomic<int64_t> BaseCotMock<IO>::total_cots(0);
 
 #endif // BASE_COT_MOCK_H__
@@ -3,6 +3,7 @@
 
 // Note: emp-tool provided via emp-vole-mock.h
 #include "emp-zk/emp-vole/utility.h"
+#include <atomic>
 
 // Direct mock VOLE - NO communication, hardcoded correlations
 // Both parties derive same Delta and values from fixed seeds
@@ -14,7 +15,8 @@ public:
   IO *io;
   __uint128_t Delta;
   PRG sync_prg;
-  static int64_t total_base_voles;
+  // Atomic: both parties may run in one process (LocalIO)
+  static std::atomic<int64_t> total_base_voles;
 
   // Hardcoded Delta derived from fixed seed (same for both parties)
   static __uint128_t get_hardcoded_delta() {
@@ -82,6 +84,6 @@ public:
 };
 
 template <typename IO>
-int64_t Base_svole_direct_mock<IO>::total_base_voles = 0;
+std::atomic<int64_t> Base_svole_direct_mock<IO>::total_base_voles(0);
 
 #endif // BASE_VOLE_DIRECT_MOCK_H__
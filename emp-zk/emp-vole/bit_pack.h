@@ -0,0 +1,56 @@
+#ifndef EMP_BIT_PACK_H__
+#define EMP_BIT_PACK_H__
+
+// Bit-packed bool arrays, least significant bit first: bit i of the array is
+// bit (i % 8) of byte i / 8. pack_bits/unpack_bits convert 8 bools per step
+// with 64-bit multiply tricks, so they vectorize on any target without
+// intrinsics (bool is one byte holding 0 or 1).
+
+#include <cstdint>
+#include <cstring>
+
+namespace emp {
+
+inline int64_t packed_bytes(int64_t n) { return (n + 7) / 8; }
+
+inline bool get_bit(const uint8_t *bits, int64_t i) {
+  return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+inline void xor_bit(uint8_t *bits, int64_t i, bool b) {
+  bits[i >> 3] ^= (uint8_t)((uint8_t)b << (i & 7));
+}
+
+// out[0, packed_bytes(n)) = in[0, n); unused high bits of the last byte are 0
+inline void pack_bits(uint8_t *out, const bool *in, int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t x;
+    memcpy(&x, in + i, 8);
+    // Byte k holds bit k; the multiply gathers them into the top byte
+    out[i >> 3] = (uint8_t)((x * 0x0102040810204080ULL) >> 56);
+  }
+  if (i < n) {
+    uint8_t last = 0;
+    for (int k = 0; i + k < n; ++k)
+      last |= (uint8_t)((uint8_t)in[i + k] << k);
+    out[i >> 3] = last;
+  }
+}
+
+inline void unpack_bits(bool *out, const uint8_t *in, int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // Byte k of the broadcast keeps bit k, then becomes 0 or 1
+    uint64_t x = ((uint64_t)in[i >> 3] * 0x0101010101010101ULL) &
+                 0x8040201008040201ULL;
+    x = ((x + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+    memcpy(out + i, &x, 8);
+  }
+  for (; i < n; ++i)
+    out[i] = get_bit(in, i);
+}
+
+} // namespace emp
+
+#endif // EMP_BIT_PACK_H__
@@ -0,0 +1,99 @@
+#ifndef EMP_BLAKE3_BATCH_H__
+#define EMP_BLAKE3_BATCH_H__
+
+// Multi-message BLAKE3 for the VOLE hot loops. blake3_hash_many runs the
+// widest backend blake3_dispatch.c detects (16 lanes on AVX-512, 8 on AVX2,
+// 4 on SSE4.1, portable otherwise), so callers hash many short messages per
+// call instead of one hasher per message.
+
+#include "emp-zk/emp-vole/blake3.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+// Internal BLAKE3 entry points (blake3_dispatch.c)
+void blake3_hash_many(const uint8_t *const *inputs, size_t num_inputs,
+                      size_t blocks, const uint32_t key[8], uint64_t counter,
+                      bool increment_counter, uint8_t flags,
+                      uint8_t flags_start, uint8_t flags_end, uint8_t *out);
+size_t blake3_simd_degree(void);
+}
+
+namespace emp {
+
+const static uint32_t BLAKE3_BATCH_IV[8] = {
+    0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
+    0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL};
+
+// Message length of every batched input: one full compression block
+const static int BLAKE3_BATCH_MSG_LEN = 64;
+
+// out[32 * i ..] = BLAKE3(msgs[i][0..64)) for i < n. Equal to blake3_hasher
+// on the same 64 bytes, truncated to 32 bytes of output.
+inline void blake3_hash64_batch(const uint8_t *const *msgs, size_t n,
+                                uint8_t *out) {
+  // CHUNK_START on the first block, CHUNK_END | ROOT on the last (same block)
+  blake3_hash_many(msgs, n, 1, BLAKE3_BATCH_IV, 0, false, 0, 1 << 0,
+                   (1 << 1) | (1 << 3), out);
+}
+
+// Correlation-robust hash of OTPre: out[i] = H(start + i || in[i] ^ mask),
+// where H is BLAKE3 over the 64-byte zero-padded message (8-byte index,
+// 16-byte value), truncated to 16 bytes. in, out and mask are 16-byte
+// values; mask may be nullptr and out may alias in.
+inline void blake3_crh16_batch(void *out, const void *in, const void *mask,
+                               uint64_t start, size_t n) {
+  const size_t kBatch = 64;
+  uint8_t msg[kBatch][BLAKE3_BATCH_MSG_LEN];
+  const uint8_t *msgs[kBatch];
+  uint8_t dgst[kBatch * 32];
+  uint64_t m[2] = {0, 0};
+  if (mask != nullptr)
+    memcpy(m, mask, 16);
+  memset(msg, 0, sizeof(msg));
+  for (size_t i = 0; i < kBatch; ++i)
+    msgs[i] = msg[i];
+  const uint8_t *src = (const uint8_t *)in;
+  uint8_t *dst = (uint8_t *)out;
+  for (size_t done = 0; done < n; done += kBatch) {
+    size_t len = n - done < kBatch ? n - done : kBatch;
+    for (size_t i = 0; i < len; ++i) {
+      uint64_t idx = start + done + i, v[2];
+      memcpy(v, src + 16 * (done + i), 16);
+      v[0] ^= m[0];
+      v[1] ^= m[1];
+      memcpy(msg[i], &idx, 8);
+      memcpy(msg[i] + 8, v, 16);
+    }
+    blake3_hash64_batch(msgs, len, dgst);
+    for (size_t i = 0; i < len; ++i)
+      memcpy(dst + 16 * (done + i), dgst + 32 * i, 16);
+  }
+}
+
+// Keyed BLAKE3 XOF of 64 zero bytes: out[32 * i ..] is the first half of
+// output block counter + i, for i < n. Every lane compresses the same block
+// with its own output counter, so the stream is seekable and runs at full
+// SIMD width. The shim PRG draws its bytes from here.
+inline void blake3_keyed_stream(const uint32_t key[8], uint64_t counter,
+                                size_t n, uint8_t *out) {
+  static const uint8_t zeros[BLAKE3_BATCH_MSG_LEN] = {0};
+  const size_t kBatch = 64;
+  const uint8_t *msgs[kBatch];
+  for (size_t i = 0; i < kBatch; ++i)
+    msgs[i] = zeros;
+  // KEYED_HASH on every block, CHUNK_START, then CHUNK_END | ROOT
+  for (size_t done = 0; done < n; done += kBatch) {
+    size_t len = n - done < kBatch ? n - done : kBatch;
+    blake3_hash_many(msgs, len, 1, key, counter + done, true, 1 << 4, 1 << 0,
+                     (1 << 1) | (1 << 3), out + 32 * done);
+  }
+}
+
+// Lanes the dispatcher will use on this CPU
+inline int blake3_batch_lanes() { return (int)blake3_simd_degree(); }
+
+} // namespace emp
+
+#endif // EMP_BLAKE3_BATCH_H__
@@ -0,0 +1,196 @@
+#ifndef _EA_CODE_FP_BLAKE3_H__
+#define _EA_CODE_FP_BLAKE3_H__
+
+// Expand-accumulate compression for dual-LPN VOLE (Boyle et al., "Correlated
+// Pseudorandomness from Expand-Accumulate Codes", CRYPTO 2022), in the dual
+// encoding order of libOTe's EACode: the noisy vector e of length
+// code_n = t * 2^log_bin_sz is accumulated in place (prefix sums mod p, one
+// streaming pass), then output j is the sum of d accumulated entries at
+// BLAKE3-derived positions. The expansion draws its indices from LpnFpBlake3
+// with k = code_n, so it shares the index stream and the gather kernels.
+//
+// The noise is kept as one 64-bit word per position: the sender's y words,
+// or the receiver's z words. The receiver's x words are zero outside the
+// punctured leaf of each bin, so their prefix sums are a step function of
+// t steps; it is evaluated from a t-entry table at each gathered index
+// instead of being stored. Both parties gather 8-byte words from a code_n
+// array, and write the 16-byte outputs a row block at a time.
+//
+// Unlike the primal final stage there is no k-sized pre-VOLE vector: a round
+// consumes only the t + kMpfssCheckMasks base VOLEs of its MPFSS.
+
+#include "emp-zk/emp-vole/lpn_blake3.h"
+#include "emp-zk/emp-vole/lpn_param_blake3.h"
+#include <cmath>
+
+namespace emp {
+
+// Regular noise weight for a rate-1/2 code with relative minimum distance
+// 0.1, as libOTe's getRegNoiseWeight: t >= -security / log2(1 - 2 * 0.1).
+// The distance is assumed for d = 10 expansion, not derived here.
+inline int64_t ea_min_noise_fp61(int security) {
+  return (int64_t)std::ceil(security / -std::log2(1 - 2 * 0.1));
+}
+
+// Code length of an EA final stage (the final stage of p as rewritten by
+// ea_param_fp61)
+inline int64_t ea_code_n_fp61(const PrimalLPNParameterFp61Blake3 &p) {
+  return p.t << p.log_bin_sz;
+}
+
+// Dual-LPN variant of p with the same outputs per round: the final stage
+// becomes n outputs, k = 0, and t bins of 2^log_bin_sz over a code of length
+// at least 2n, with the largest bins that keep t at the noise weight bound.
+// Stage 0 is kept for bootstrapping; stage 1 is not run.
+inline PrimalLPNParameterFp61Blake3 ea_param_fp61(PrimalLPNParameterFp61Blake3 p,
+                                                 int security = 128) {
+  int64_t t_min = ea_min_noise_fp61(security);
+  int log_bin_sz = 1;
+  while (((2 * p.n) >> (log_bin_sz + 1)) >= t_min)
+    ++log_bin_sz;
+  int64_t bin = 1LL << log_bin_sz;
+  p.t = (2 * p.n + bin - 1) / bin;
+  p.log_bin_sz = log_bin_sz;
+  p.k = 0;
+  if (p.n_pre0 < p.t + kMpfssCheckMasks || p.buf_sz() <= 0)
+    error("EA parameter not matched");
+  return p;
+}
+
+template <int d = 10> class EaCodeFpBlake3 {
+public:
+  int64_t n, code_n;
+  int log_bin_sz;
+  ThreadPool *pool;
+  int threads;
+  LpnFpBlake3<d> expand;
+  // Per-chunk totals of the accumulate pass
+  std::vector<uint64_t> part_sum;
+  // Receiver's accumulated x words per bin: lo before the punctured leaf
+  // at, hi from it on
+  struct Step {
+    int64_t at;
+    uint64_t lo, hi;
+  };
+  std::vector<Step> steps;
+  // Identity indices of a row block, to sum per-index x values with the
+  // gather kernel's row layout
+  std::vector<int> iota;
+
+  EaCodeFpBlake3(int64_t n, int64_t t, int log_bin_sz, ThreadPool *pool,
+                 int threads, block seed = zero_block)
+      : n(n), code_n(t << log_bin_sz), log_bin_sz(log_bin_sz), pool(pool),
+        threads(threads), expand(n, t << log_bin_sz, pool, threads, seed),
+        part_sum(threads + 1), steps(t), iota(kRowBlock * d) {
+    for (int i = 0; i < kRowBlock * d; ++i)
+      iota[i] = i;
+  }
+
+  // e[i] = e[0] + ... + e[i] mod p. Runs in threads + 1 chunks: each chunk
+  // is summed locally, then shifted by the totals of the chunks before it.
+  void accumulate(uint64_t *e) {
+    VOLE_TRACE("ea_accumulate", code_n);
+    VOLE_PHASE(VOLE_PHASE_EA_ACCUMULATE);
+    const int parts = threads + 1;
+    const int64_t width = (code_n + parts - 1) / parts;
+    run_parts(parts, [this, e, width](int p) {
+      int64_t start = p * width, end = std::min(code_n, start + width);
+      uint64_t s = 0;
+      for (int64_t i = start; i < end; ++i)
+        e[i] = s = add_mod(s, e[i]);
+      part_sum[p] = s;
+    });
+    uint64_t s = 0;
+    for (int p = 0; p < parts; ++p) {
+      uint64_t ps = part_sum[p];
+      part_sum[p] = s;
+      s = add_mod(s, ps);
+    }
+    run_parts(parts, [this, e, width](int p) {
+      int64_t start = p * width, end = std::min(code_n, start + width);
+      uint64_t s = part_sum[p];
+      if (p == 0)
+        return;
+      for (int64_t i = start; i < end; ++i)
+        e[i] = add_mod(e[i], s);
+    });
+  }
+
+  // out[0, n) = H * e for the sender's y words; e is overwritten
+  void encode_send(__uint128_t *out, uint64_t *e) {
+    accumulate(e);
+    run_rows([this, out, e](int64_t j, int rows, const int *idx) {
+      uint64_t y[kRowBlock] = {0};
+      fp61_lpn_send_rows_u64(y, e, idx, rows, d);
+      for (int r = 0; r < rows; ++r)
+        out[j + r] = y[r];
+    });
+  }
+
+  // out[0, n) = H * e for the receiver: z holds the z words (overwritten),
+  // and bin b's only nonzero x word is beta[b], at position at[b]
+  void encode_recv(__uint128_t *out, uint64_t *z, const int64_t *at,
+                   const uint64_t *beta) {
+    accumulate(z);
+    uint64_t s = 0;
+    for (size_t b = 0; b < steps.size(); ++b) {
+      steps[b].at = at[b];
+      steps[b].lo = s;
+      s = add_mod(s, beta[b]);
+      steps[b].hi = s;
+    }
+    run_rows([this, out, z](int64_t j, int rows, const int *idx) {
+      uint64_t x[kRowBlock] = {0}, zr[kRowBlock] = {0};
+      uint64_t xv[kRowBlock * d];
+      const Step *st = steps.data();
+      const int shift = log_bin_sz;
+      for (int i = 0; i < rows * d; ++i) {
+        // Branch-free: the two sides of the step are equally likely
+        const Step &s = st[idx[i] >> shift];
+        uint64_t past = 0 - (uint64_t)(idx[i] >= s.at);
+        xv[i] = s.lo ^ ((s.lo ^ s.hi) & past);
+      }
+      fp61_lpn_send_rows_u64(zr, z, idx, rows, d);
+      fp61_lpn_send_rows_u64(x, xv, iota.data(), rows, d);
+      for (int r = 0; r < rows; ++r)
+        out[j + r] = ((__uint128_t)x[r] << 64) | zr[r];
+    });
+  }
+
+private:
+  static const int kRowBlock = LpnFpBlake3<d>::kRowBlock;
+
+  // Calls f(row0, rows, indices) on each row block of [0, n), split over
+  // the pool like LpnFpBlake3::compute
+  template <typename F> void run_rows(F f) {
+    const int parts = threads + 1;
+    const int64_t width = n / parts;
+    run_parts(parts, [this, &f, parts, width](int p) {
+      int64_t start = p * width, end = p == parts - 1 ? n : start + width;
+      VOLE_TRACE("lpn_task", start);
+      int idx[kRowBlock * d];
+      for (int64_t j = start; j < end; j += kRowBlock) {
+        int rows = (int)std::min((int64_t)kRowBlock, end - j);
+        {
+          VOLE_PHASE(VOLE_PHASE_LPN_INDEX);
+          expand.blake3_indices(j, rows, idx);
+        }
+        VOLE_PHASE(VOLE_PHASE_LPN_GATHER);
+        f(j, rows, idx);
+      }
+      VOLE_COUNT(VOLE_COUNT_LPN_ROWS, end - start);
+    });
+  }
+
+  template <typename F> void run_parts(int parts, F f) {
+    vector<std::future<void>> fut;
+    for (int p = 0; p < parts - 1; ++p)
+      fut.push_back(pool->enqueue([&f, p]() { f(p); }));
+    f(parts - 1);
+    for (auto &x : fut)
+      x.get();
+  }
+};
+
+} // namespace emp
+#endif // _EA_CODE_FP_BLAKE3_H__
@@ -20,6 +20,7 @@
 #include "spfss_sender_blake3.h"
 #include "spfss_recver_blake3.h"
 #include "mpfss_reg_blake3.h"
+#include "lpn_param_blake3.h"
 #include "lpn_blake3.h"
 #include "vole_triple_blake3.h"
 
@@ -14,10 +14,15 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
 
 extern "C" {
 #include "blake3.h"
 }
+#include "vole_alloc.h"
+#include "vole_stats.h"
+#include "bit_pack.h"
+#include "blake3_batch.h"
 
 namespace emp {
 
@@ -34,6 +39,39 @@ inline void error(const char* msg) {
     abort();
 }
 
+// Thrown by the transports when the peer's connection is gone (closed
+// socket, WebSocket error or close, receive timeout) instead of aborting,
+// so a resumable VoleTripleBlake3 session can reconnect. Uncaught it ends
+// the process like error().
+class VoleConnectionLost : public std::runtime_error {
+public:
+    explicit VoleConnectionLost(const char* what) : std::runtime_error(what) {}
+};
+
+// io->reconnect() for transports that can re-establish their connection
+// (NetIO, LocalIO); false for the rest
+template <typename IO>
+auto vole_io_reconnect(IO* io, int) -> decltype(io->reconnect()) {
+    return io->reconnect();
+}
+template <typename IO> bool vole_io_reconnect(IO*, long) { return false; }
+
+// io->fork() / enter() / join() for transports that keep a timeline per
+// thread (SimIO) while a second thread borrows them; no-ops for the rest
+template <typename IO> auto vole_io_fork(IO* io, int) -> decltype(io->fork()) {
+    io->fork();
+}
+template <typename IO> void vole_io_fork(IO*, long) {}
+template <typename IO>
+auto vole_io_enter(IO* io, int) -> decltype(io->enter()) {
+    io->enter();
+}
+template <typename IO> void vole_io_enter(IO*, long) {}
+template <typename IO> auto vole_io_join(IO* io, int) -> decltype(io->join()) {
+    io->join();
+}
+template <typename IO> void vole_io_join(IO*, long) {}
+
 //=============================================================================
 // Block type (128-bit)
 //=============================================================================
@@ -184,40 +222,57 @@ T vector_inn_prdt_sum_red(const T *a, const T *b, int sz) {
 // BLAKE3-based PRG
 //=============================================================================
 
+// Counter mode over the keyed BLAKE3 XOF (blake3_keyed_stream): the
+// 128-bit seed, zero-padded, is the key, and output comes in 32-byte blocks.
+// Requests of 32 bytes or more are written straight to the caller through
+// blake3_hash_many; smaller ones are served from a buffer of kBufBlocks
+// blocks. The stream does not depend on how the requests are split.
 class PRG {
-    uint64_t counter;
-    uint8_t buffer[64];
+    static const int kBufBlocks = 16;
+    uint32_t key[8];
+    uint64_t counter;  // next output block not yet generated
+    uint8_t buffer[32 * kBufBlocks];
     int buffer_pos;
+
 public:
-    PRG(const block* seed = nullptr) : counter(0), buffer_pos(64) {
-        if (seed) memcpy(&counter, seed, sizeof(uint64_t));
-        else {
+    PRG(const block* seed = nullptr) {
+        if (seed) {
+            reseed(seed);
+        } else {
             std::random_device rd;
-            counter = ((uint64_t)rd() << 32) | rd();
+            uint32_t w[4] = {rd(), rd(), rd(), rd()};
+            block s;
+            memcpy(&s, w, sizeof(block));
+            reseed(&s);
         }
     }
 
     void reseed(const block* seed) {
-        memcpy(&counter, seed, sizeof(uint64_t));
-        buffer_pos = 64;
+        memset(key, 0, sizeof(key));
+        memcpy(key, seed, sizeof(block));
+        counter = 0;
+        buffer_pos = sizeof(buffer);
     }
 
     void random_data(void* data, int nbytes) {
         uint8_t* out = (uint8_t*)data;
-        while (nbytes > 0) {
-            if (buffer_pos >= 64) {
-                blake3_hasher h;
-                blake3_hasher_init(&h);
-                blake3_hasher_update(&h, &counter, sizeof(counter));
-                blake3_hasher_finalize(&h, buffer, 64);
-                counter++;
-                buffer_pos = 0;
-            }
-            int copy = std::min(nbytes, 64 - buffer_pos);
-            memcpy(out, buffer + buffer_pos, copy);
-            out += copy;
-            buffer_pos += copy;
-            nbytes -= copy;
+        int copy = std::min(nbytes, (int)sizeof(buffer) - buffer_pos);
+        memcpy(out, buffer + buffer_pos, copy);
+        buffer_pos += copy;
+        out += copy;
+        nbytes -= copy;
+        if (nbytes >= 32) {
+            size_t blocks = nbytes / 32;
+            blake3_keyed_stream(key, counter, blocks, out);
+            counter += blocks;
+            out += 32 * blocks;
+            nbytes -= 32 * (int)blocks;
+        }
+        if (nbytes > 0) {
+            blake3_keyed_stream(key, counter, kBufBlocks, buffer);
+            counter += kBufBlocks;
+            memcpy(out, buffer, nbytes);
+            buffer_pos = nbytes;
         }
     }
 
@@ -225,12 +280,14 @@ public:
         random_data(data, nblocks * sizeof(block));
     }
 
+    // One output bit per bool, unpacked in chunks (bit_pack.h)
     void random_bool(bool* data, int n) {
-        uint8_t* tmp = new uint8_t[n];
-        random_data(tmp, n);
-        for (int i = 0; i < n; i++)
-            data[i] = tmp[i] & 1;
-        delete[] tmp;
+        uint8_t bits[256];
+        for (int done = 0; done < n; done += 8 * (int)sizeof(bits)) {
+            int len = std::min(n - done, 8 * (int)sizeof(bits));
+            random_data(bits, (int)packed_bytes(len));
+            unpack_bits(data + done, bits, len);
+        }
     }
 };
 
@@ -360,66 +417,44 @@ public:
         snprintf(url_buf, sizeof(url_buf), "ws://%s:%d", address, port);
         ws_url = url_buf;
 
-        printf("Connecting to %s...\n", ws_url);
-
-        EmscriptenWebSocketCreateAttributes attr;
-        emscripten_websocket_init_create_attributes(&attr);
-        attr.url = ws_url;
-        attr.protocols = nullptr;
-
-        ws = emscripten_websocket_new(&attr);
-        if (ws <= 0) {
-            error("Failed to create WebSocket");
-            return;
-        }
-
-        emscripten_websocket_set_onopen_callback(ws, this, on_open);
-        emscripten_websocket_set_onmessage_callback(ws, this, on_message);
-        emscripten_websocket_set_onerror_callback(ws, this, on_error);
-        emscripten_websocket_set_onclose_callback(ws, this, on_close);
-
-        // Wait for connection
-        int timeout = 10000;
-        while (!connected && !error_occurred && timeout > 0) {
-            emscripten_sleep(50);
-            timeout -= 50;
-        }
-
-        if (!connected) {
+        if (!open()) {
             error("WebSocket connection timeout");
             return;
         }
-        printf("connected\n");
     }
 
-    ~NetIO() {
-        if (ws > 0) {
-            emscripten_websocket_close(ws, 1000, "done");
-            emscripten_websocket_delete(ws);
-        }
+    ~NetIO() { close_ws("done"); }
+
+    // A new WebSocket to the same URL; bytes still in flight on the old one
+    // are dropped. False if it does not open within 10 seconds.
+    bool reconnect() {
+        close_ws("reconnect");
+        recv_buffer.clear();
+        return open();
     }
 
     void send_data(const void* data, int len) {
-        if (!connected || ws <= 0) return;
+        VOLE_TRACE("send", len);
+        if (!connected || ws <= 0)
+            throw VoleConnectionLost("WebSocket closed during send");
         emscripten_websocket_send_binary(ws, (void*)data, len);
         bytes_sent += len;
     }
 
     void recv_data(void* data, int len) {
+        VOLE_PHASE(VOLE_PHASE_NET_WAIT);
+        VOLE_COUNT(VOLE_COUNT_RECV_CALLS, 1);
         int timeout = 60000;  // 60 second timeout
         while ((int)recv_buffer.size() < len && timeout > 0) {
-            if (error_occurred) {
-                error("WebSocket error during recv");
-                return;
-            }
+            if (error_occurred || !connected)
+                throw VoleConnectionLost("WebSocket closed during recv");
             emscripten_sleep(10);
             timeout -= 10;
         }
 
         if ((int)recv_buffer.size() < len) {
             fprintf(stderr, "Receive timeout (got %zu, need %d)\n", recv_buffer.size(), len);
-            error("WebSocket receive timeout");
-            return;
+            throw VoleConnectionLost("WebSocket receive timeout");
         }
 
         memcpy(data, recv_buffer.data(), len);
@@ -434,6 +469,46 @@ public:
     }
 
 private:
+    bool open() {
+        printf("Connecting to %s...\n", ws_url);
+        connected = false;
+        error_occurred = false;
+
+        EmscriptenWebSocketCreateAttributes attr;
+        emscripten_websocket_init_create_attributes(&attr);
+        attr.url = ws_url;
+        attr.protocols = nullptr;
+
+        ws = emscripten_websocket_new(&attr);
+        if (ws <= 0)
+            return false;
+
+        emscripten_websocket_set_onopen_callback(ws, this, on_open);
+        emscripten_websocket_set_onmessage_callback(ws, this, on_message);
+        emscripten_websocket_set_onerror_callback(ws, this, on_error);
+        emscripten_websocket_set_onclose_callback(ws, this, on_close);
+
+        // Wait for connection
+        int timeout = 10000;
+        while (!connected && !error_occurred && timeout > 0) {
+            emscripten_sleep(50);
+            timeout -= 50;
+        }
+        if (!connected)
+            return false;
+        printf("connected\n");
+        return true;
+    }
+
+    void close_ws(const char* reason) {
+        if (ws > 0) {
+            emscripten_websocket_close(ws, 1000, reason);
+            emscripten_websocket_delete(ws);
+            ws = 0;
+        }
+        connected = false;
+    }
+
     static EM_BOOL on_open(int, const EmscriptenWebSocketOpenEvent*, void* ud) {
         ((NetIO*)ud)->connected = true;
         return EM_TRUE;
@@ -463,6 +538,7 @@ private:
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <errno.h>
 #include <unistd.h>
 
 namespace emp {
@@ -470,6 +546,7 @@ namespace emp {
 class NetIO {
     int sock, consock;
     bool is_server;
+    struct sockaddr_in addr;
 public:
     size_t bytes_sent = 0;
     size_t bytes_recv = 0;
@@ -479,7 +556,6 @@ public:
         consock = -1;
         sock = socket(AF_INET, SOCK_STREAM, 0);
 
-        struct sockaddr_in addr;
         memset(&addr, 0, sizeof(addr));
         addr.sin_family = AF_INET;
         addr.sin_port = htons(port);
@@ -501,25 +577,51 @@ public:
         }
     }
 
+    // Drops the connection and waits for the peer's next one: the server
+    // accepts again on its listening socket, the client reconnects for up
+    // to 10 seconds. Bytes still in flight are lost.
+    bool reconnect() {
+        if (is_server) {
+            if (consock >= 0) close(consock);
+            consock = accept(sock, nullptr, nullptr);
+            return consock >= 0;
+        }
+        close(sock);
+        sock = consock = socket(AF_INET, SOCK_STREAM, 0);
+        for (int i = 0; i < 100; ++i) {
+            if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0)
+                return true;
+            usleep(100000);
+        }
+        return false;
+    }
+
     ~NetIO() {
         if (consock >= 0 && consock != sock) close(consock);
         if (sock >= 0) close(sock);
     }
 
     void send_data(const void* data, int len) {
+        VOLE_TRACE("send", len);
         int sent = 0;
         while (sent < len) {
-            int r = send(consock, (char*)data + sent, len - sent, 0);
+            int r = send(consock, (char*)data + sent, len - sent, MSG_NOSIGNAL);
             if (r > 0) sent += r;
+            else if (r < 0 && errno != EINTR)
+                throw VoleConnectionLost("connection lost during send");
         }
         bytes_sent += len;
     }
 
     void recv_data(void* data, int len) {
+        VOLE_PHASE(VOLE_PHASE_NET_WAIT);
+        VOLE_COUNT(VOLE_COUNT_RECV_CALLS, 1);
         int recvd = 0;
         while (recvd < len) {
             int r = recv(consock, (char*)data + recvd, len - recvd, 0);
             if (r > 0) recvd += r;
+            else if (r == 0 || errno != EINTR)
+                throw VoleConnectionLost("connection lost during recv");
         }
         bytes_recv += len;
     }
@@ -547,71 +649,69 @@ class OTPre {
 public:
     IO* io;
     block* pre_data = nullptr;
-    bool* bits = nullptr;
+    // Choice bits, packed (bit_pack.h); the choice message is this array
+    uint8_t* bits = nullptr;
     int n, length, count;
     block Delta;
+    // Pads sent or received, 2 per OT, once keep_wire() was called
+    // (Fiat-Shamir transcript of MpfssRegFpBlake3)
+    std::vector<block> wire;
 
     OTPre(IO* io, int length, int times) : io(io), length(length) {
         n = length * times;
-        pre_data = new block[2 * n];
-        bits = new bool[n];
+        pre_data = vole_alloc_array<block>(2 * n);
+        bits = new uint8_t[packed_bytes(n)]();
         count = 0;
     }
 
     ~OTPre() {
-        delete[] pre_data;
+        vole_free(pre_data);
         delete[] bits;
     }
 
+    // pre_data[i] = H(i || data[i]) and, for the sender, pre_data[n + i] =
+    // H(i || data[i] ^ Delta), hashed across the BLAKE3 lanes
+    // (blake3_crh16_batch)
     void send_pre(block* data, block in_Delta) {
+        VOLE_PHASE(VOLE_PHASE_OT_PREHASH);
         Delta = in_Delta;
-        Hash hash;
-        for (int i = 0; i < n; ++i) {
-            hash.reset();
-            hash.put(&i, sizeof(i));
-            hash.put(&data[i], sizeof(block));
-            hash.digest(&pre_data[i], sizeof(block));
-        }
-        for (int i = 0; i < n; ++i) {
-            block tmp = data[i] ^ Delta;
-            hash.reset();
-            hash.put(&i, sizeof(i));
-            hash.put(&tmp, sizeof(block));
-            hash.digest(&pre_data[n + i], sizeof(block));
-        }
+        blake3_crh16_batch(pre_data, data, nullptr, 0, n);
+        blake3_crh16_batch(pre_data + n, data, &Delta, 0, n);
     }
 
     void recv_pre(block* data, bool* b) {
-        memcpy(bits, b, n);
-        Hash hash;
-        for (int i = 0; i < n; ++i) {
-            hash.reset();
-            hash.put(&i, sizeof(i));
-            hash.put(&data[i], sizeof(block));
-            hash.digest(&pre_data[i], sizeof(block));
-        }
+        VOLE_PHASE(VOLE_PHASE_OT_PREHASH);
+        pack_bits(bits, b, n);
+        blake3_crh16_batch(pre_data, data, nullptr, 0, n);
     }
 
-    void choices_sender() {
-        io->recv_data(bits + count, length);
-        count += length;
-    }
+    // One tree's choices; the bits of all trees go out in one packed
+    // message, send_choices() -> recv_choices()
+    void choices_sender() { count += length; }
 
     void choices_recver(bool* b) {
         for (int i = 0; i < length; ++i)
-            bits[count + i] = (b[i] != bits[count + i]);
-        io->send_data(bits + count, length);
+            xor_bit(bits, count + i, b[i]);
         count += length;
     }
 
+    void send_choices() { io->send_data(bits, (int)packed_bytes(count)); }
+
+    void recv_choices() { io->recv_data(bits, (int)packed_bytes(count)); }
+
     void reset() { count = 0; }
 
+    void keep_wire() { wire.resize(2 * (size_t)n); }
+
     void send(const block* m0, const block* m1, int len, IO* io2, int s) {
         block pad[2];
         int k = s * length;
         for (int i = 0; i < len; ++i) {
-            pad[0] = m0[i] ^ pre_data[bits[k] ? k + n : k];
-            pad[1] = m1[i] ^ pre_data[bits[k] ? k : k + n];
+            bool c = get_bit(bits, k);
+            pad[0] = m0[i] ^ pre_data[c ? k + n : k];
+            pad[1] = m1[i] ^ pre_data[c ? k : k + n];
+            if (!wire.empty())
+                memcpy(&wire[2 * (size_t)k], pad, sizeof(pad));
             ++k;
             io2->send_data(pad, sizeof(pad));
         }
@@ -622,6 +722,8 @@ public:
         block pad[2];
         for (int i = 0; i < len; ++i) {
             io2->recv_data(pad, sizeof(pad));
+            if (!wire.empty())
+                memcpy(&wire[2 * (size_t)k], pad, sizeof(pad));
             // b[i] is the receiver's actual choice - use it to select pad
             data[i] = pre_data[k] ^ pad[b[i] ? 1 : 0];
             ++k;
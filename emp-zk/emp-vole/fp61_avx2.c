@@ -0,0 +1,170 @@
+#include "fp61_impl.h"
+
+#include <immintrin.h>
+
+FP61_INLINE __m256i mod4(__m256i x) {
+  const __m256i P = _mm256_set1_epi64x((long long)FP61_PR);
+  x = _mm256_add_epi64(_mm256_and_si256(x, P), _mm256_srli_epi64(x, FP61_EXP));
+  __m256i lt = _mm256_cmpgt_epi64(P, x);
+  return _mm256_sub_epi64(x, _mm256_andnot_si256(lt, P));
+}
+
+FP61_INLINE __m256i add_mod4(__m256i a, __m256i b) {
+  const __m256i P = _mm256_set1_epi64x((long long)FP61_PR);
+  __m256i s = _mm256_add_epi64(a, b);
+  __m256i lt = _mm256_cmpgt_epi64(P, s);
+  return _mm256_sub_epi64(s, _mm256_andnot_si256(lt, P));
+}
+
+// Low words of the four elements v[0..4)
+FP61_INLINE __m256i load_lo4(const uint64_t *v) {
+  __m256i a = _mm256_loadu_si256((const __m256i *)v);
+  __m256i b = _mm256_loadu_si256((const __m256i *)(v + 4));
+  return _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+}
+
+// v[0..4) = (x[c], 0)
+FP61_INLINE void store_lo4(uint64_t *v, __m256i x) {
+  __m256i lo = _mm256_unpacklo_epi64(x, _mm256_setzero_si256());
+  __m256i hi = _mm256_unpackhi_epi64(x, _mm256_setzero_si256());
+  _mm256_storeu_si256((__m256i *)v, _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i *)(v + 4),
+                      _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+// Low words of preK[p[0..4)]
+FP61_INLINE __m256i gather_lo4(const uint64_t *preK, const int *p) {
+  __m128i v = _mm_slli_epi32(_mm_loadu_si128((const __m128i *)p), 1);
+  return _mm256_i32gather_epi64((const long long *)preK, v, 8);
+}
+
+// preK[p[0..4)] of packed 64-bit words
+FP61_INLINE __m256i gather_u64x4(const uint64_t *preK, const int *p) {
+  return _mm256_i32gather_epi64((const long long *)preK,
+                                _mm_loadu_si128((const __m128i *)p), 8);
+}
+
+// Both words of preM[a] and preM[b]
+FP61_INLINE __m256i load_pair(const uint64_t *preM, int a, int b) {
+  __m128i x = _mm_loadu_si128((const __m128i *)(preM + 2 * (size_t)a));
+  __m128i y = _mm_loadu_si128((const __m128i *)(preM + 2 * (size_t)b));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(x), y, 1);
+}
+
+FP61_INLINE void send4(uint64_t *K, const uint64_t *preK, const int *p,
+                       int d) {
+  __m256i acc = _mm256_setzero_si256();
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      acc = mod4(acc);
+    acc = _mm256_add_epi64(acc, gather_lo4(preK, p + 4 * j));
+  }
+  store_lo4(K, mod4(_mm256_add_epi64(load_lo4(K), acc)));
+}
+
+// send4 over packed 64-bit K and preK
+FP61_INLINE void send4_u64(uint64_t *K, const uint64_t *preK, const int *p,
+                           int d) {
+  __m256i acc = _mm256_setzero_si256();
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      acc = mod4(acc);
+    acc = _mm256_add_epi64(acc, gather_u64x4(preK, p + 4 * j));
+  }
+  __m256i k = _mm256_loadu_si256((const __m256i *)K);
+  _mm256_storeu_si256((__m256i *)K, mod4(_mm256_add_epi64(k, acc)));
+}
+
+FP61_INLINE void recv4(uint64_t *M, const uint64_t *preM, const int *p,
+                       int d) {
+  __m256i acc0 = _mm256_loadu_si256((const __m256i *)M);
+  __m256i acc1 = _mm256_loadu_si256((const __m256i *)(M + 4));
+  for (int j = 0; j < d; ++j, p += 4) {
+    if (j > 0 && j % FP61_FOLD == 0) {
+      acc0 = mod4(acc0);
+      acc1 = mod4(acc1);
+    }
+    acc0 = _mm256_add_epi64(acc0, load_pair(preM, p[0], p[1]));
+    acc1 = _mm256_add_epi64(acc1, load_pair(preM, p[2], p[3]));
+  }
+  _mm256_storeu_si256((__m256i *)M, mod4(acc0));
+  _mm256_storeu_si256((__m256i *)(M + 4), mod4(acc1));
+}
+
+// Four split-receiver rows: x and z words gathered four at a time, at the
+// same indices
+FP61_INLINE void recv4_soa(uint64_t *X, uint64_t *Z, const uint64_t *preX,
+                           const uint64_t *preZ, const int *p, int d) {
+  __m256i accx = _mm256_loadu_si256((const __m256i *)X);
+  __m256i accz = _mm256_loadu_si256((const __m256i *)Z);
+  for (int j = 0; j < d; ++j, p += 4) {
+    if (j > 0 && j % FP61_FOLD == 0) {
+      accx = mod4(accx);
+      accz = mod4(accz);
+    }
+    accx = _mm256_add_epi64(accx, gather_u64x4(preX, p));
+    accz = _mm256_add_epi64(accz, gather_u64x4(preZ, p));
+  }
+  _mm256_storeu_si256((__m256i *)X, mod4(accx));
+  _mm256_storeu_si256((__m256i *)Z, mod4(accz));
+}
+
+void fp61_lpn_send_rows_avx2(uint64_t *K, const uint64_t *preK, const int *idx,
+                             size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 4 <= rows; r += 4)
+    send4(K + 2 * r, preK, idx + (size_t)d * r, d);
+  fp61_send_rows_tail(K, preK, idx, r, rows, d, 2);
+}
+
+void fp61_lpn_send_rows_u64_avx2(uint64_t *K, const uint64_t *preK,
+                                 const int *idx, size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 4 <= rows; r += 4)
+    send4_u64(K + r, preK, idx + (size_t)d * r, d);
+  fp61_send_rows_tail(K, preK, idx, r, rows, d, 1);
+}
+
+void fp61_lpn_recv_rows_avx2(uint64_t *M, const uint64_t *preM, const int *idx,
+                             size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 4 <= rows; r += 4)
+    recv4(M + 2 * r, preM, idx + (size_t)d * r, d);
+  fp61_recv_rows_tail(M, preM, idx, r, rows, d);
+}
+
+void fp61_lpn_recv_rows_soa_avx2(uint64_t *X, uint64_t *Z, const uint64_t *preX,
+                                 const uint64_t *preZ, const int *idx,
+                                 size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 4 <= rows; r += 4)
+    recv4_soa(X + r, Z + r, preX, preZ, idx + (size_t)d * r, d);
+  fp61_recv_rows_soa_tail(X, Z, preX, preZ, idx, r, rows, d);
+}
+
+uint64_t fp61_reduce_sum_avx2(uint64_t *v, size_t n) {
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = mod4(load_lo4(v + 2 * i));
+    store_lo4(v + 2 * i, x);
+    acc = add_mod4(acc, x);
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, acc);
+  uint64_t sum = fp61_add_mod(fp61_add_mod(lanes[0], lanes[1]),
+                              fp61_add_mod(lanes[2], lanes[3]));
+  return fp61_reduce_sum_tail(v, i, n, sum);
+}
+
+// No 64x64-bit vector multiply below AVX-512 IFMA; the scalar loop gets
+// mulx from -mbmi2
+uint64_t fp61_inner_product_avx2(const uint64_t *a, const uint64_t *b,
+                                 size_t n) {
+  return fp61_inner_product_scalar(a, b, n, 2);
+}
+
+uint64_t fp61_inner_product_u64_avx2(const uint64_t *a, const uint64_t *b,
+                                     size_t n) {
+  return fp61_inner_product_scalar(a, b, n, 1);
+}
@@ -0,0 +1,177 @@
+#include "fp61_impl.h"
+
+#include <immintrin.h>
+
+FP61_INLINE __m512i mod8(__m512i x) {
+  const __m512i P = _mm512_set1_epi64((long long)FP61_PR);
+  x = _mm512_add_epi64(_mm512_and_si512(x, P), _mm512_srli_epi64(x, FP61_EXP));
+  return _mm512_mask_sub_epi64(x, _mm512_cmpge_epu64_mask(x, P), x, P);
+}
+
+FP61_INLINE __m512i add_mod8(__m512i a, __m512i b) {
+  const __m512i P = _mm512_set1_epi64((long long)FP61_PR);
+  __m512i s = _mm512_add_epi64(a, b);
+  return _mm512_mask_sub_epi64(s, _mm512_cmpge_epu64_mask(s, P), s, P);
+}
+
+// Low words of the eight elements v[0..8)
+FP61_INLINE __m512i load_lo8(const uint64_t *v) {
+  const __m512i even = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+  return _mm512_permutex2var_epi64(_mm512_loadu_si512(v), even,
+                                   _mm512_loadu_si512(v + 8));
+}
+
+// v[0..8) = (x[c], 0)
+FP61_INLINE void store_lo8(uint64_t *v, __m512i x) {
+  const __m512i lo = _mm512_setr_epi64(0, 8, 1, 8, 2, 8, 3, 8);
+  const __m512i hi = _mm512_setr_epi64(4, 8, 5, 8, 6, 8, 7, 8);
+  const __m512i z = _mm512_setzero_si512();
+  _mm512_storeu_si512(v, _mm512_permutex2var_epi64(x, lo, z));
+  _mm512_storeu_si512(v + 8, _mm512_permutex2var_epi64(x, hi, z));
+}
+
+// Low words of preK[a[0..4)] and preK[b[0..4)]
+FP61_INLINE __m512i gather_lo8(const uint64_t *preK, const int *a,
+                               const int *b) {
+  __m256i v = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+      _mm_loadu_si128((const __m128i *)b), 1);
+  return _mm512_i32gather_epi64(_mm256_slli_epi32(v, 1), preK, 8);
+}
+
+// preK[a[0..4)] and preK[b[0..4)] of packed 64-bit words
+FP61_INLINE __m512i gather_u64x8(const uint64_t *preK, const int *a,
+                                 const int *b) {
+  __m256i v = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+      _mm_loadu_si128((const __m128i *)b), 1);
+  return _mm512_i32gather_epi64(v, preK, 8);
+}
+
+// Both words of preM[p[0..4)]
+FP61_INLINE __m512i load_quad(const uint64_t *preM, const int *p) {
+  __m512i x = _mm512_castsi128_si512(
+      _mm_loadu_si128((const __m128i *)(preM + 2 * (size_t)p[0])));
+  x = _mm512_inserti32x4(
+      x, _mm_loadu_si128((const __m128i *)(preM + 2 * (size_t)p[1])), 1);
+  x = _mm512_inserti32x4(
+      x, _mm_loadu_si128((const __m128i *)(preM + 2 * (size_t)p[2])), 2);
+  return _mm512_inserti32x4(
+      x, _mm_loadu_si128((const __m128i *)(preM + 2 * (size_t)p[3])), 3);
+}
+
+// Two consecutive four-row groups, rows 0-3 from idx[0..4d), 4-7 from
+// idx[4d..8d)
+FP61_INLINE void send8(uint64_t *K, const uint64_t *preK, const int *p,
+                       int d) {
+  const int *q = p + 4 * d;
+  __m512i acc = _mm512_setzero_si512();
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      acc = mod8(acc);
+    acc = _mm512_add_epi64(acc, gather_lo8(preK, p + 4 * j, q + 4 * j));
+  }
+  store_lo8(K, mod8(_mm512_add_epi64(load_lo8(K), acc)));
+}
+
+// send8 over packed 64-bit K and preK
+FP61_INLINE void send8_u64(uint64_t *K, const uint64_t *preK, const int *p,
+                           int d) {
+  const int *q = p + 4 * d;
+  __m512i acc = _mm512_setzero_si512();
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      acc = mod8(acc);
+    acc = _mm512_add_epi64(acc, gather_u64x8(preK, p + 4 * j, q + 4 * j));
+  }
+  _mm512_storeu_si512(K, mod8(_mm512_add_epi64(_mm512_loadu_si512(K), acc)));
+}
+
+FP61_INLINE void recv4(uint64_t *M, const uint64_t *preM, const int *p,
+                       int d) {
+  __m512i acc = _mm512_loadu_si512(M);
+  for (int j = 0; j < d; ++j, p += 4) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      acc = mod8(acc);
+    acc = _mm512_add_epi64(acc, load_quad(preM, p));
+  }
+  _mm512_storeu_si512(M, mod8(acc));
+}
+
+// Eight split-receiver rows as send8_u64, for the x and the z words
+FP61_INLINE void recv8_soa(uint64_t *X, uint64_t *Z, const uint64_t *preX,
+                           const uint64_t *preZ, const int *p, int d) {
+  const int *q = p + 4 * d;
+  __m512i accx = _mm512_loadu_si512(X);
+  __m512i accz = _mm512_loadu_si512(Z);
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0) {
+      accx = mod8(accx);
+      accz = mod8(accz);
+    }
+    accx = _mm512_add_epi64(accx, gather_u64x8(preX, p + 4 * j, q + 4 * j));
+    accz = _mm512_add_epi64(accz, gather_u64x8(preZ, p + 4 * j, q + 4 * j));
+  }
+  _mm512_storeu_si512(X, mod8(accx));
+  _mm512_storeu_si512(Z, mod8(accz));
+}
+
+void fp61_lpn_send_rows_avx512(uint64_t *K, const uint64_t *preK,
+                               const int *idx, size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 8 <= rows; r += 8)
+    send8(K + 2 * r, preK, idx + (size_t)d * r, d);
+  fp61_send_rows_tail(K, preK, idx, r, rows, d, 2);
+}
+
+void fp61_lpn_send_rows_u64_avx512(uint64_t *K, const uint64_t *preK,
+                                   const int *idx, size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 8 <= rows; r += 8)
+    send8_u64(K + r, preK, idx + (size_t)d * r, d);
+  fp61_send_rows_tail(K, preK, idx, r, rows, d, 1);
+}
+
+void fp61_lpn_recv_rows_avx512(uint64_t *M, const uint64_t *preM,
+                               const int *idx, size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 4 <= rows; r += 4)
+    recv4(M + 2 * r, preM, idx + (size_t)d * r, d);
+  fp61_recv_rows_tail(M, preM, idx, r, rows, d);
+}
+
+void fp61_lpn_recv_rows_soa_avx512(uint64_t *X, uint64_t *Z,
+                                   const uint64_t *preX, const uint64_t *preZ,
+                                   const int *idx, size_t rows, int d) {
+  size_t r = 0;
+  for (; r + 8 <= rows; r += 8)
+    recv8_soa(X + r, Z + r, preX, preZ, idx + (size_t)d * r, d);
+  fp61_recv_rows_soa_tail(X, Z, preX, preZ, idx, r, rows, d);
+}
+
+uint64_t fp61_reduce_sum_avx512(uint64_t *v, size_t n) {
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i x = mod8(load_lo8(v + 2 * i));
+    store_lo8(v + 2 * i, x);
+    acc = add_mod8(acc, x);
+  }
+  uint64_t lanes[8];
+  _mm512_storeu_si512(lanes, acc);
+  uint64_t sum = 0;
+  for (int c = 0; c < 8; ++c)
+    sum = fp61_add_mod(sum, lanes[c]);
+  return fp61_reduce_sum_tail(v, i, n, sum);
+}
+
+// No IFMA assumed; the scalar loop gets mulx from -mbmi2
+uint64_t fp61_inner_product_avx512(const uint64_t *a, const uint64_t *b,
+                                   size_t n) {
+  return fp61_inner_product_scalar(a, b, n, 2);
+}
+
+uint64_t fp61_inner_product_u64_avx512(const uint64_t *a, const uint64_t *b,
+                                       size_t n) {
+  return fp61_inner_product_scalar(a, b, n, 1);
+}
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fp61_impl.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define FP61_X86_DETECT
+#endif
+
+#define FP61_LEVEL_UNDEFINED (-1)
+
+static int g_fp61_level = FP61_LEVEL_UNDEFINED;
+
+static enum fp61_level detect_level(void) {
+  enum fp61_level level = FP61_LEVEL_BASELINE;
+#if defined(FP61_X86_DETECT)
+  __builtin_cpu_init();
+#if !defined(FP61_NO_AVX2)
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+    level = FP61_LEVEL_AVX2;
+#endif
+#if !defined(FP61_NO_AVX512)
+  if (level == FP61_LEVEL_AVX2 && __builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512vl"))
+    level = FP61_LEVEL_AVX512;
+#endif
+#endif
+  // Let benchmarks and tests pin a lower level
+  const char *env = getenv("VOLE_CPU");
+  if (env != NULL) {
+    enum fp61_level cap = level;
+    if (strcmp(env, "baseline") == 0)
+      cap = FP61_LEVEL_BASELINE;
+    else if (strcmp(env, "avx2") == 0)
+      cap = FP61_LEVEL_AVX2;
+    if (cap < level)
+      level = cap;
+  }
+  return level;
+}
+
+enum fp61_level fp61_cpu_level(void) {
+  int level = __atomic_load_n(&g_fp61_level, __ATOMIC_RELAXED);
+  if (level == FP61_LEVEL_UNDEFINED) {
+    level = (int)detect_level();
+    __atomic_store_n(&g_fp61_level, level, __ATOMIC_RELAXED);
+  }
+  return (enum fp61_level)level;
+}
+
+const char *fp61_level_name(enum fp61_level level) {
+  switch (level) {
+  case FP61_LEVEL_AVX512:
+    return "avx512";
+  case FP61_LEVEL_AVX2:
+    return "avx2";
+  default:
+    return "baseline";
+  }
+}
+
+void fp61_lpn_send_rows(uint64_t *K, const uint64_t *preK, const int *idx,
+                        size_t rows, int d) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    fp61_lpn_send_rows_avx512(K, preK, idx, rows, d);
+    return;
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    fp61_lpn_send_rows_avx2(K, preK, idx, rows, d);
+    return;
+#endif
+  default:
+    fp61_lpn_send_rows_portable(K, preK, idx, rows, d);
+  }
+}
+
+void fp61_lpn_recv_rows(uint64_t *M, const uint64_t *preM, const int *idx,
+                        size_t rows, int d) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    fp61_lpn_recv_rows_avx512(M, preM, idx, rows, d);
+    return;
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    fp61_lpn_recv_rows_avx2(M, preM, idx, rows, d);
+    return;
+#endif
+  default:
+    fp61_lpn_recv_rows_portable(M, preM, idx, rows, d);
+  }
+}
+
+uint64_t fp61_reduce_sum(uint64_t *v, size_t n) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    return fp61_reduce_sum_avx512(v, n);
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    return fp61_reduce_sum_avx2(v, n);
+#endif
+  default:
+    return fp61_reduce_sum_portable(v, n);
+  }
+}
+
+uint64_t fp61_inner_product(const uint64_t *a, const uint64_t *b, size_t n) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    return fp61_inner_product_avx512(a, b, n);
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    return fp61_inner_product_avx2(a, b, n);
+#endif
+  default:
+    return fp61_inner_product_portable(a, b, n);
+  }
+}
+
+void fp61_lpn_send_rows_u64(uint64_t *K, const uint64_t *preK, const int *idx,
+                            size_t rows, int d) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    fp61_lpn_send_rows_u64_avx512(K, preK, idx, rows, d);
+    return;
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    fp61_lpn_send_rows_u64_avx2(K, preK, idx, rows, d);
+    return;
+#endif
+  default:
+    fp61_lpn_send_rows_u64_portable(K, preK, idx, rows, d);
+  }
+}
+
+void fp61_lpn_recv_rows_soa(uint64_t *X, uint64_t *Z, const uint64_t *preX,
+                            const uint64_t *preZ, const int *idx, size_t rows,
+                            int d) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    fp61_lpn_recv_rows_soa_avx512(X, Z, preX, preZ, idx, rows, d);
+    return;
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    fp61_lpn_recv_rows_soa_avx2(X, Z, preX, preZ, idx, rows, d);
+    return;
+#endif
+  default:
+    fp61_lpn_recv_rows_soa_portable(X, Z, preX, preZ, idx, rows, d);
+  }
+}
+
+uint64_t fp61_inner_product_u64(const uint64_t *a, const uint64_t *b,
+                                size_t n) {
+  switch (fp61_cpu_level()) {
+#if !defined(FP61_NO_AVX512)
+  case FP61_LEVEL_AVX512:
+    return fp61_inner_product_u64_avx512(a, b, n);
+#endif
+#if !defined(FP61_NO_AVX2)
+  case FP61_LEVEL_AVX2:
+    return fp61_inner_product_u64_avx2(a, b, n);
+#endif
+  default:
+    return fp61_inner_product_u64_portable(a, b, n);
+  }
+}
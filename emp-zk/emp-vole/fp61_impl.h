@@ -0,0 +1,214 @@
+#ifndef FP61_IMPL_H
+#define FP61_IMPL_H
+
+// Scalar building blocks shared by every fp61_*.c backend. The SIMD backends
+// use them for tails, so all levels produce bit-identical output.
+
+#include "fp61_kernels.h"
+
+#define FP61_PR 2305843009213693951ULL
+#define FP61_EXP 61
+// LPN gather-adds fold their sums every FP61_FOLD indices: a reduced value
+// plus FP61_FOLD + 1 more (the last being the sender's K) stays below 2^64
+#define FP61_FOLD 5
+
+#if defined(_MSC_VER)
+#define FP61_INLINE static __forceinline
+#else
+#define FP61_INLINE static inline __attribute__((always_inline))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One folding step plus a conditional subtract, as mod() in emp_tool_shim.h
+FP61_INLINE uint64_t fp61_mod(uint64_t x) {
+  uint64_t i = (x & FP61_PR) + (x >> FP61_EXP);
+  return (i >= FP61_PR) ? i - FP61_PR : i;
+}
+
+FP61_INLINE uint64_t fp61_add_mod(uint64_t a, uint64_t b) {
+  uint64_t res = a + b;
+  return (res >= FP61_PR) ? (res - FP61_PR) : res;
+}
+
+FP61_INLINE uint64_t fp61_mult_mod(uint64_t a, uint64_t b) {
+  unsigned __int128 r = (unsigned __int128)a * b;
+  uint64_t lo = (uint64_t)r & FP61_PR;
+  uint64_t hi = (uint64_t)(r >> FP61_EXP);
+  return fp61_mod(lo + hi);
+}
+
+// Sender rows take a word stride s: 2 for __uint128_t elements (the high
+// word is zeroed), 1 for the packed 64-bit storage of a compact sender
+FP61_INLINE void fp61_send4_portable(uint64_t *K, const uint64_t *preK,
+                                     const int *p, int d, int s) {
+  uint64_t tmp[4] = {0, 0, 0, 0};
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      for (int c = 0; c < 4; ++c)
+        tmp[c] = fp61_mod(tmp[c]);
+    for (int c = 0; c < 4; ++c)
+      tmp[c] += preK[s * (size_t)*(p++)];
+  }
+  for (int c = 0; c < 4; ++c) {
+    K[s * c] = fp61_mod(K[s * c] + tmp[c]);
+    if (s == 2)
+      K[2 * c + 1] = 0;
+  }
+}
+
+FP61_INLINE void fp61_send1_portable(uint64_t *K, const uint64_t *preK,
+                                     const int *p, int d, int s) {
+  uint64_t k = K[0];
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      k = fp61_mod(k);
+    k += preK[s * (size_t)p[j]];
+  }
+  K[0] = fp61_mod(k);
+  if (s == 2)
+    K[1] = 0;
+}
+
+FP61_INLINE void fp61_recv4_portable(uint64_t *M, const uint64_t *preM,
+                                     const int *p, int d) {
+  uint64_t tmp[8];
+  for (int w = 0; w < 8; ++w)
+    tmp[w] = M[w];
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0)
+      for (int w = 0; w < 8; ++w)
+        tmp[w] = fp61_mod(tmp[w]);
+    for (int c = 0; c < 4; ++c, ++p) {
+      tmp[2 * c] += preM[2 * (size_t)*p];
+      tmp[2 * c + 1] += preM[2 * (size_t)*p + 1];
+    }
+  }
+  for (int w = 0; w < 8; ++w)
+    M[w] = fp61_mod(tmp[w]);
+}
+
+FP61_INLINE void fp61_recv1_portable(uint64_t *M, const uint64_t *preM,
+                                     const int *p, int d) {
+  uint64_t lo = M[0], hi = M[1];
+  for (int j = 0; j < d; ++j) {
+    if (j > 0 && j % FP61_FOLD == 0) {
+      lo = fp61_mod(lo);
+      hi = fp61_mod(hi);
+    }
+    lo += preM[2 * (size_t)p[j]];
+    hi += preM[2 * (size_t)p[j] + 1];
+  }
+  M[0] = fp61_mod(lo);
+  M[1] = fp61_mod(hi);
+}
+
+// Rows from `r` on, after a SIMD backend has handled rows [0, r)
+FP61_INLINE void fp61_send_rows_tail(uint64_t *K, const uint64_t *preK,
+                                     const int *idx, size_t r, size_t rows,
+                                     int d, int s) {
+  for (; r + 4 <= rows; r += 4)
+    fp61_send4_portable(K + s * r, preK, idx + (size_t)d * r, d, s);
+  for (; r < rows; ++r)
+    fp61_send1_portable(K + s * r, preK, idx + (size_t)d * r, d, s);
+}
+
+FP61_INLINE void fp61_recv_rows_tail(uint64_t *M, const uint64_t *preM,
+                                     const int *idx, size_t r, size_t rows,
+                                     int d) {
+  for (; r + 4 <= rows; r += 4)
+    fp61_recv4_portable(M + 2 * r, preM, idx + (size_t)d * r, d);
+  for (; r < rows; ++r)
+    fp61_recv1_portable(M + 2 * r, preM, idx + (size_t)d * r, d);
+}
+
+// Split receiver rows: each half accumulates like packed sender keys
+FP61_INLINE void fp61_recv_rows_soa_tail(uint64_t *X, uint64_t *Z,
+                                         const uint64_t *preX,
+                                         const uint64_t *preZ, const int *idx,
+                                         size_t r, size_t rows, int d) {
+  fp61_send_rows_tail(X, preX, idx, r, rows, d, 1);
+  fp61_send_rows_tail(Z, preZ, idx, r, rows, d, 1);
+}
+
+FP61_INLINE uint64_t fp61_reduce_sum_tail(uint64_t *v, size_t i, size_t n,
+                                          uint64_t sum) {
+  for (; i < n; ++i) {
+    v[2 * i] = fp61_mod(v[2 * i]);
+    v[2 * i + 1] = 0;
+    sum = fp61_add_mod(sum, v[2 * i]);
+  }
+  return sum;
+}
+
+// Four independent chains so the multiplies overlap; w is the word stride
+// (2 for __uint128_t elements, 1 for packed words)
+FP61_INLINE uint64_t fp61_inner_product_scalar(const uint64_t *a,
+                                               const uint64_t *b, size_t n,
+                                               int w) {
+  uint64_t s[4] = {0, 0, 0, 0};
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    for (int c = 0; c < 4; ++c)
+      s[c] = fp61_add_mod(s[c], fp61_mult_mod(a[w * (i + c)], b[w * (i + c)]));
+  for (; i < n; ++i)
+    s[0] = fp61_add_mod(s[0], fp61_mult_mod(a[w * i], b[w * i]));
+  return fp61_add_mod(fp61_add_mod(s[0], s[1]), fp61_add_mod(s[2], s[3]));
+}
+
+void fp61_lpn_send_rows_portable(uint64_t *K, const uint64_t *preK,
+                                 const int *idx, size_t rows, int d);
+void fp61_lpn_recv_rows_portable(uint64_t *M, const uint64_t *preM,
+                                 const int *idx, size_t rows, int d);
+void fp61_lpn_send_rows_u64_portable(uint64_t *K, const uint64_t *preK,
+                                     const int *idx, size_t rows, int d);
+void fp61_lpn_recv_rows_soa_portable(uint64_t *X, uint64_t *Z,
+                                     const uint64_t *preX, const uint64_t *preZ,
+                                     const int *idx, size_t rows, int d);
+uint64_t fp61_reduce_sum_portable(uint64_t *v, size_t n);
+uint64_t fp61_inner_product_portable(const uint64_t *a, const uint64_t *b,
+                                     size_t n);
+uint64_t fp61_inner_product_u64_portable(const uint64_t *a, const uint64_t *b,
+                                         size_t n);
+
+#if !defined(FP61_NO_AVX2)
+void fp61_lpn_send_rows_avx2(uint64_t *K, const uint64_t *preK, const int *idx,
+                             size_t rows, int d);
+void fp61_lpn_recv_rows_avx2(uint64_t *M, const uint64_t *preM, const int *idx,
+                             size_t rows, int d);
+void fp61_lpn_send_rows_u64_avx2(uint64_t *K, const uint64_t *preK,
+                                 const int *idx, size_t rows, int d);
+void fp61_lpn_recv_rows_soa_avx2(uint64_t *X, uint64_t *Z, const uint64_t *preX,
+                                 const uint64_t *preZ, const int *idx,
+                                 size_t rows, int d);
+uint64_t fp61_reduce_sum_avx2(uint64_t *v, size_t n);
+uint64_t fp61_inner_product_avx2(const uint64_t *a, const uint64_t *b,
+                                 size_t n);
+uint64_t fp61_inner_product_u64_avx2(const uint64_t *a, const uint64_t *b,
+                                     size_t n);
+#endif
+
+#if !defined(FP61_NO_AVX512)
+void fp61_lpn_send_rows_avx512(uint64_t *K, const uint64_t *preK,
+                               const int *idx, size_t rows, int d);
+void fp61_lpn_recv_rows_avx512(uint64_t *M, const uint64_t *preM,
+                               const int *idx, size_t rows, int d);
+void fp61_lpn_send_rows_u64_avx512(uint64_t *K, const uint64_t *preK,
+                                   const int *idx, size_t rows, int d);
+void fp61_lpn_recv_rows_soa_avx512(uint64_t *X, uint64_t *Z,
+                                   const uint64_t *preX, const uint64_t *preZ,
+                                   const int *idx, size_t rows, int d);
+uint64_t fp61_reduce_sum_avx512(uint64_t *v, size_t n);
+uint64_t fp61_inner_product_avx512(const uint64_t *a, const uint64_t *b,
+                                   size_t n);
+uint64_t fp61_inner_product_u64_avx512(const uint64_t *a, const uint64_t *b,
+                                       size_t n);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FP61_IMPL_H
@@ -0,0 +1,64 @@
+#ifndef FP61_KERNELS_H
+#define FP61_KERNELS_H
+
+// Hot Fp61 loops of the VOLE pipeline, built once per instruction set
+// (fp61_portable.c, fp61_avx2.c, fp61_avx512.c) and selected at runtime by
+// fp61_dispatch.c, the same way blake3_dispatch.c picks a BLAKE3 backend.
+// This keeps the native binaries free of -march=native.
+//
+// Fp61 vectors are __uint128_t arrays passed as uint64_t words: element i is
+// words (2i, 2i + 1), low word first.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum fp61_level {
+  FP61_LEVEL_BASELINE = 0,
+  FP61_LEVEL_AVX2 = 1,
+  FP61_LEVEL_AVX512 = 2,
+};
+
+// Best level this CPU supports, detected once. Setting VOLE_CPU to baseline,
+// avx2 or avx512 lowers it (never raises it past what the CPU supports).
+enum fp61_level fp61_cpu_level(void);
+const char *fp61_level_name(enum fp61_level level);
+
+// Rows per LPN kernel call share these index layouts for row weight d: rows
+// are taken four at a time with indices idx[4dg .. 4dg + 4d) interleaved
+// across the group (row c of the group reads idx[4dg + 4j + c]), leftover
+// rows read their own d indices idx[dr .. dr + d).
+
+// Sender: K[r] = K[r] + sum of d preK (low words), reduced; high word zeroed
+void fp61_lpn_send_rows(uint64_t *K, const uint64_t *preK, const int *idx,
+                        size_t rows, int d);
+// Receiver: both words of M[r] += the d preM, each word reduced
+void fp61_lpn_recv_rows(uint64_t *M, const uint64_t *preM, const int *idx,
+                        size_t rows, int d);
+// Sender with packed 64-bit storage: K and preK hold one word per element
+void fp61_lpn_send_rows_u64(uint64_t *K, const uint64_t *preK, const int *idx,
+                            size_t rows, int d);
+// Receiver with split storage: X/preX hold the x words, Z/preZ the z words,
+// one per element; both are gathered at the same indices
+void fp61_lpn_recv_rows_soa(uint64_t *X, uint64_t *Z, const uint64_t *preX,
+                            const uint64_t *preZ, const int *idx, size_t rows,
+                            int d);
+
+// Reduces the low word of v[0..n) into Fp61 in place (high word zeroed) and
+// returns their sum mod p
+uint64_t fp61_reduce_sum(uint64_t *v, size_t n);
+
+// sum a[i] * b[i] mod p over the low words
+uint64_t fp61_inner_product(const uint64_t *a, const uint64_t *b, size_t n);
+// The same over packed 64-bit words
+uint64_t fp61_inner_product_u64(const uint64_t *a, const uint64_t *b,
+                                size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FP61_KERNELS_H
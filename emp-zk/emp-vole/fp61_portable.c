@@ -0,0 +1,36 @@
+#include "fp61_impl.h"
+
+void fp61_lpn_send_rows_portable(uint64_t *K, const uint64_t *preK,
+                                 const int *idx, size_t rows, int d) {
+  fp61_send_rows_tail(K, preK, idx, 0, rows, d, 2);
+}
+
+void fp61_lpn_send_rows_u64_portable(uint64_t *K, const uint64_t *preK,
+                                     const int *idx, size_t rows, int d) {
+  fp61_send_rows_tail(K, preK, idx, 0, rows, d, 1);
+}
+
+void fp61_lpn_recv_rows_soa_portable(uint64_t *X, uint64_t *Z,
+                                     const uint64_t *preX, const uint64_t *preZ,
+                                     const int *idx, size_t rows, int d) {
+  fp61_recv_rows_soa_tail(X, Z, preX, preZ, idx, 0, rows, d);
+}
+
+void fp61_lpn_recv_rows_portable(uint64_t *M, const uint64_t *preM,
+                                 const int *idx, size_t rows, int d) {
+  fp61_recv_rows_tail(M, preM, idx, 0, rows, d);
+}
+
+uint64_t fp61_reduce_sum_portable(uint64_t *v, size_t n) {
+  return fp61_reduce_sum_tail(v, 0, n, 0);
+}
+
+uint64_t fp61_inner_product_portable(const uint64_t *a, const uint64_t *b,
+                                     size_t n) {
+  return fp61_inner_product_scalar(a, b, n, 2);
+}
+
+uint64_t fp61_inner_product_u64_portable(const uint64_t *a, const uint64_t *b,
+                                         size_t n) {
+  return fp61_inner_product_scalar(a, b, n, 1);
+}
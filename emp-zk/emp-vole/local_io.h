@@ -0,0 +1,222 @@
+#ifndef EMP_LOCAL_IO_H__
+#define EMP_LOCAL_IO_H__
+
+// In-process transport: ALICE and BOB run as two threads of one process and
+// talk through a pair of lock-free single-producer/single-consumer byte
+// rings. Same send_data/recv_data/flush interface as the shim NetIO, so
+// VoleTripleBlake3<LocalIO> runs unchanged, with no sockets or syscalls in
+// the profile.
+//
+// For fault-injection tests a LocalChannel can drop the connection after a
+// byte budget (drop_after): bytes not read yet are lost, later sends go
+// nowhere and reads throw VoleConnectionLost until both ends have called
+// reconnect(), which starts over on empty rings.
+
+#include "emp-zk/emp-vole/emp_tool_shim.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace emp {
+
+// One direction of a LocalChannel. Exactly one thread writes and one reads.
+class LocalRing {
+public:
+  explicit LocalRing(size_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+      error("LocalRing capacity must be a power of two");
+    buf.resize(capacity);
+    mask = capacity - 1;
+  }
+
+  // Set while the owning channel is dropped: reads and writes throw, so
+  // bytes not read yet are lost, as on a broken socket
+  const std::atomic<bool> *dead = nullptr;
+
+  // Empties the ring; neither end may be using it
+  void reset() {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+  }
+
+  void write(const void *data, size_t len) {
+    const uint8_t *src = (const uint8_t *)data;
+    while (len > 0) {
+      size_t h = head.load(std::memory_order_relaxed);
+      size_t n = wait([&]() {
+        return buf.size() - (h - tail.load(std::memory_order_acquire));
+      });
+      n = std::min(n, len);
+      copy_in(h, src, n);
+      head.store(h + n, std::memory_order_release);
+      src += n;
+      len -= n;
+    }
+  }
+
+  void read(void *data, size_t len) {
+    uint8_t *dst = (uint8_t *)data;
+    while (len > 0) {
+      size_t t = tail.load(std::memory_order_relaxed);
+      size_t n = wait([&]() {
+        return head.load(std::memory_order_acquire) - t;
+      });
+      n = std::min(n, len);
+      copy_out(t, dst, n);
+      tail.store(t + n, std::memory_order_release);
+      dst += n;
+      len -= n;
+    }
+  }
+
+private:
+  std::vector<uint8_t> buf;
+  size_t mask;
+  // Producer and consumer cursors on separate cache lines
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+
+  // Spin briefly, then yield so the peer thread can run on a shared core
+  template <typename F> size_t wait(F avail) {
+    size_t n;
+    int spins = 0;
+    for (;;) {
+      if (dead != nullptr && dead->load(std::memory_order_relaxed))
+        throw VoleConnectionLost("LocalIO connection dropped");
+      if ((n = avail()) != 0)
+        return n;
+      if (++spins > 64)
+        std::this_thread::yield();
+    }
+  }
+
+  void copy_in(size_t pos, const uint8_t *src, size_t n) {
+    size_t off = pos & mask;
+    size_t first = std::min(n, buf.size() - off);
+    memcpy(buf.data() + off, src, first);
+    memcpy(buf.data(), src + first, n - first);
+  }
+
+  void copy_out(size_t pos, uint8_t *dst, size_t n) {
+    size_t off = pos & mask;
+    size_t first = std::min(n, buf.size() - off);
+    memcpy(dst, buf.data() + off, first);
+    memcpy(dst + first, buf.data(), n - first);
+  }
+};
+
+// Both directions between ALICE and BOB. Each ring must hold the largest
+// flight one side sends before reading, as a socket buffer would.
+class LocalChannel {
+public:
+  LocalRing alice_to_bob, bob_to_alice;
+  std::atomic<bool> dead{false};
+  int64_t drops = 0;
+  // Runs on each revival with the channel locked, e.g. to arm the next
+  // fault
+  std::function<void()> on_reconnect;
+
+  explicit LocalChannel(size_t capacity = 1 << 22)
+      : alice_to_bob(capacity), bob_to_alice(capacity) {
+    alice_to_bob.dead = bob_to_alice.dead = &dead;
+  }
+
+  // Drops the connection once bytes more bytes have been sent either way;
+  // -1 disarms
+  void drop_after(int64_t bytes) {
+    budget.store(bytes, std::memory_order_relaxed);
+  }
+
+  // Called before every send of len bytes; false once the channel is down
+  // (from the send that uses up the budget on): the send returns but its
+  // bytes are lost, as on a broken socket whose error shows up at the next
+  // read
+  bool charge(size_t len) {
+    if (budget.load(std::memory_order_relaxed) >= 0) {
+      int64_t left = budget.fetch_sub((int64_t)len) - (int64_t)len;
+      if (left < 0 && left + (int64_t)len >= 0) {
+        budget.store(-1, std::memory_order_relaxed);
+        ++drops;
+        dead.store(true);
+      }
+    }
+    return !dead.load(std::memory_order_relaxed);
+  }
+
+  // Both ends call it after a drop; the second arrival empties the rings
+  // and revives the channel. False if the peer does not arrive within
+  // timeout_ms.
+  bool reconnect(int timeout_ms = 10000) {
+    std::unique_lock<std::mutex> lock(m);
+    int64_t gen = generation;
+    if (++arrived == 2) {
+      alice_to_bob.reset();
+      bob_to_alice.reset();
+      arrived = 0;
+      ++generation;
+      dead.store(false);
+      if (on_reconnect)
+        on_reconnect();
+      cv.notify_all();
+      return true;
+    }
+    if (!cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                     [&]() { return generation != gen; })) {
+      --arrived;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  std::atomic<int64_t> budget{-1};
+  std::mutex m;
+  std::condition_variable cv;
+  int arrived = 0;
+  int64_t generation = 0;
+};
+
+class LocalIO {
+  LocalChannel *ch;
+  LocalRing *out, *in;
+
+public:
+  size_t bytes_sent = 0;
+  size_t bytes_recv = 0;
+
+  LocalIO(LocalChannel *ch, int party) : ch(ch) {
+    out = party == ALICE ? &ch->alice_to_bob : &ch->bob_to_alice;
+    in = party == ALICE ? &ch->bob_to_alice : &ch->alice_to_bob;
+  }
+
+  bool reconnect() { return ch->reconnect(); }
+
+  void send_data(const void *data, int len) {
+    VOLE_TRACE("send", len);
+    if (!ch->charge(len))
+      return;
+    out->write(data, len);
+    bytes_sent += len;
+  }
+
+  void recv_data(void *data, int len) {
+    VOLE_PHASE(VOLE_PHASE_NET_WAIT);
+    VOLE_COUNT(VOLE_COUNT_RECV_CALLS, 1);
+    in->read(data, len);
+    bytes_recv += len;
+  }
+
+  void flush() {}
+
+  void print_stats() {
+    printf("\n--- Network Statistics ---\n");
+    printf("Bytes sent:     %zu (%.2f MB)\n", bytes_sent, bytes_sent / 1048576.0);
+    printf("Bytes received: %zu (%.2f MB)\n", bytes_recv, bytes_recv / 1048576.0);
+  }
+};
+
+} // namespace emp
+
+#endif // EMP_LOCAL_IO_H__
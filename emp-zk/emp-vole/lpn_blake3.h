@@ -5,11 +5,20 @@
 
 // Note: emp-tool included via emp-vole-mock.h
 #include "emp-zk/emp-vole/utility.h"
-#include "emp-zk/emp-vole/blake3.h"
+#include "emp-zk/emp-vole/blake3_batch.h"
+#include "emp-zk/emp-vole/fp61_kernels.h"
+#include "emp-zk/emp-vole/lpn_param_blake3.h"
 
 namespace emp {
 
-template <int d = 10> class LpnFpBlake3 {
+// Smallest all-ones mask covering [0, k)
+constexpr uint32_t lpn_k_mask(int64_t k, uint32_t m = 1) {
+  return m < (uint32_t)k ? lpn_k_mask(k, (m << 1) | 1) : m;
+}
+
+// Stage = LpnStageFixed<...> makes n, k and the index mask compile-time
+// constants; LpnStageDynamic takes them from the constructor
+template <int d = 10, typename Stage = LpnStageDynamic> class LpnFpBlake3 {
 public:
   int party;
   int k, n;
@@ -21,167 +30,106 @@ public:
   const __uint128_t *preM, *prex;
   __uint128_t *K;
   const __uint128_t *preK;
+  // Compact sender storage: one word per element, used instead of K/preK
+  // when set
+  uint64_t *K64 = nullptr;
+  const uint64_t *preK64 = nullptr;
+  // Split receiver storage: x and z words in separate arrays, used instead
+  // of M/preM when set
+  uint64_t *MX = nullptr, *MZ = nullptr;
+  const uint64_t *preMX = nullptr, *preMZ = nullptr;
 
   uint32_t k_mask;
+  // BLAKE3 key of the index stream: the seed, then a domain tag
+  uint32_t index_key[8];
 
   LpnFpBlake3(int n, int k, ThreadPool *pool, int threads, block seed = zero_block) {
+    if (Stage::fixed && (n != Stage::n || k != Stage::k))
+      error("LPN size does not match the fixed parameter set");
     this->k = k;
     this->n = n;
     this->pool = pool;
     this->threads = threads;
     this->seed_lo = _mm_extract_epi64(seed, 0);
     this->seed_hi = _mm_extract_epi64(seed, 1);
+    memset(index_key, 0, sizeof(index_key));
+    memcpy(index_key, &seed_lo, 8);
+    memcpy(index_key + 2, &seed_hi, 8);
+    memcpy(index_key + 4, "LPN-IDX", 8);
 
-    k_mask = 1;
-    while (k_mask < (uint32_t)k) {
-      k_mask <<= 1;
-      k_mask = k_mask | 0x1;
-    }
-  }
-
-  // Generate random indices using BLAKE3 instead of AES-based PRP
-  void blake3_indices(int row, int *indices, int count) {
-    uint8_t input[24];
-    uint8_t output[64];
-    blake3_hasher h;
-
-    // Input: seed (16 bytes) + row (4 bytes)
-    memcpy(input, &seed_lo, 8);
-    memcpy(input + 8, &seed_hi, 8);
-    memcpy(input + 16, &row, 4);
-    input[20] = 0; input[21] = 0; input[22] = 0; input[23] = 0;
-
-    blake3_hasher_init(&h);
-    blake3_hasher_update(&h, input, 24);
-    blake3_hasher_finalize(&h, output, 64);
-
-    uint32_t *r = (uint32_t *)output;
-    for (int j = 0; j < count && j < 16; ++j) {
-      indices[j] = r[j] & k_mask;
-      indices[j] = indices[j] >= k ? indices[j] - k : indices[j];
-    }
-  }
-
-  void add2_single(int idx1, int *idx2) {
-    block Midx1 = (block)M[idx1];
-    for (int j = 0; j < 5; ++j)
-      Midx1 = _mm_add_epi64(Midx1, (block)preM[idx2[j]]);
-    Midx1 = vec_mod(Midx1);
-    for (int j = 5; j < 10; ++j)
-      Midx1 = _mm_add_epi64(Midx1, (block)preM[idx2[j]]);
-    M[idx1] = (__uint128_t)vec_mod(Midx1);
+    k_mask = lpn_k_mask(k);
   }
 
-  void add1_single(int idx1, int *idx2) {
-    uint64_t Kidx1 = K[idx1];
-    for (int j = 0; j < 5; ++j)
-      Kidx1 = Kidx1 + preK[idx2[j]];
-    Kidx1 = mod(Kidx1);
-    for (int j = 5; j < 10; ++j)
-      Kidx1 = Kidx1 + preK[idx2[j]];
-    K[idx1] = mod(Kidx1);
+  int kk() const { return Stage::fixed ? (int)Stage::k : k; }
+  uint32_t mask() const { return Stage::fixed ? lpn_k_mask(Stage::k) : k_mask; }
+
+  static_assert(d > 0, "LPN rows need at least one index");
+
+  // Words of one index stream block (a 32-byte keyed BLAKE3 XOF block)
+  static const int kBlockWords = 8;
+
+  // Indices of rows [row0, row0 + rows) in the kernels' layout
+  // (fp61_kernels.h): index j of row r is word d * r + j of the keyed
+  // stream blake3_keyed_stream(index_key, 0, ..), so every hashed word is
+  // used, whatever d is. Each group of four rows is interleaved on the way
+  // out, so the matrix does not depend on where blocks and threads split
+  // the rows.
+  void blake3_indices(int64_t row0, int rows, int *indices) {
+    uint32_t w[kRowBlock * d + 2 * kBlockWords];
+    int64_t w0 = row0 * d, w1 = (row0 + rows) * d;
+    int64_t b0 = w0 / kBlockWords, b1 = (w1 + kBlockWords - 1) / kBlockWords;
+    blake3_keyed_stream(index_key, b0, b1 - b0, (uint8_t *)w);
+
+    const uint32_t msk = mask();
+    const int kv = kk();
+    const uint32_t *src = w + (w0 - b0 * kBlockWords);
+    auto index = [src, msk, kv](int i) {
+      int idx = src[i] & msk;
+      return idx >= kv ? idx - kv : idx;
+    };
+    const int grouped = rows & ~3;
+    for (int g = 0; g < grouped; g += 4)
+      for (int j = 0; j < d; ++j)
+        for (int c = 0; c < 4; ++c)
+          indices[g * d + 4 * j + c] = index((g + c) * d + j);
+    for (int i = grouped * d; i < rows * d; ++i)
+      indices[i] = index(i);
   }
 
-  void add2(int idx1, int *idx2) {
-    block tmp[4];
-    tmp[0] = (block)M[idx1];
-    tmp[1] = (block)M[idx1 + 1];
-    tmp[2] = (block)M[idx1 + 2];
-    tmp[3] = (block)M[idx1 + 3];
-    int *p = idx2;
-    for (int j = 0; j < 5; ++j) {
-      tmp[0] = _mm_add_epi64((block)tmp[0], (block)preM[*(p++)]);
-      tmp[1] = _mm_add_epi64((block)tmp[1], (block)preM[*(p++)]);
-      tmp[2] = _mm_add_epi64((block)tmp[2], (block)preM[*(p++)]);
-      tmp[3] = _mm_add_epi64((block)tmp[3], (block)preM[*(p++)]);
-    }
-    tmp[0] = vec_mod(tmp[0]);
-    tmp[1] = vec_mod(tmp[1]);
-    tmp[2] = vec_mod(tmp[2]);
-    tmp[3] = vec_mod(tmp[3]);
-    for (int j = 5; j < 10; ++j) {
-      tmp[0] = _mm_add_epi64((block)tmp[0], (block)preM[*(p++)]);
-      tmp[1] = _mm_add_epi64((block)tmp[1], (block)preM[*(p++)]);
-      tmp[2] = _mm_add_epi64((block)tmp[2], (block)preM[*(p++)]);
-      tmp[3] = _mm_add_epi64((block)tmp[3], (block)preM[*(p++)]);
-    }
-    M[idx1] = (__uint128_t)vec_mod(tmp[0]);
-    M[idx1 + 1] = (__uint128_t)vec_mod(tmp[1]);
-    M[idx1 + 2] = (__uint128_t)vec_mod(tmp[2]);
-    M[idx1 + 3] = (__uint128_t)vec_mod(tmp[3]);
-  }
-
-  void add1(int idx1, int *idx2) {
-    uint64_t tmp[4];
-    tmp[0] = 0;
-    tmp[1] = 0;
-    tmp[2] = 0;
-    tmp[3] = 0;
-    int *p = idx2;
-    for (int j = 0; j < 5; ++j) {
-      tmp[0] += preK[*(p++)];
-      tmp[1] += preK[*(p++)];
-      tmp[2] += preK[*(p++)];
-      tmp[3] += preK[*(p++)];
-    }
-    tmp[0] = mod(tmp[0]);
-    tmp[1] = mod(tmp[1]);
-    tmp[2] = mod(tmp[2]);
-    tmp[3] = mod(tmp[3]);
-    for (int j = 5; j < 10; ++j) {
-      tmp[0] += preK[*(p++)];
-      tmp[1] += preK[*(p++)];
-      tmp[2] += preK[*(p++)];
-      tmp[3] += preK[*(p++)];
-    }
-    K[idx1] = mod(K[idx1] + tmp[0]);
-    K[idx1 + 1] = mod(K[idx1 + 1] + tmp[1]);
-    K[idx1 + 2] = mod(K[idx1 + 2] + tmp[2]);
-    K[idx1 + 3] = mod(K[idx1 + 3] + tmp[3]);
-  }
-
-  void __compute4(int i, std::function<void(int, int *)> add_func) {
-    int indices[4 * d];
-    // Generate indices for 4 rows at once
-    for (int r = 0; r < 4; ++r) {
-      blake3_indices(i + r, indices + r * d, d);
-    }
-    add_func(i, indices);
-  }
-
-  void __compute1(int i, std::function<void(int, int *)> add_func) {
-    int indices[d];
-    blake3_indices(i, indices, d);
-    add_func(i, indices);
-  }
+  // Rows whose indices are hashed before one gather-add pass (at most 16 KB
+  // of indices for d <= 16, so they stay in L1/L2 and the phase timers run
+  // once per block)
+  static const int kRowBlock = 256;
 
+  // Gather-adds run in fp61_kernels.h, dispatched on the CPU level
   void task(int start, int end) {
-    int j = start;
-    if (party == 1) {
-      std::function<void(int, int *)> add_func1 = std::bind(
-          &LpnFpBlake3::add1, this, std::placeholders::_1, std::placeholders::_2);
-      std::function<void(int, int *)> add_func1s =
-          std::bind(&LpnFpBlake3::add1_single, this, std::placeholders::_1,
-                    std::placeholders::_2);
-      for (; j < end - 4; j += 4)
-        __compute4(j, add_func1);
-      for (; j < end; ++j)
-        __compute1(j, add_func1s);
-    } else {
-      std::function<void(int, int *)> add_func2 = std::bind(
-          &LpnFpBlake3::add2, this, std::placeholders::_1, std::placeholders::_2);
-      std::function<void(int, int *)> add_func2s =
-          std::bind(&LpnFpBlake3::add2_single, this, std::placeholders::_1,
-                    std::placeholders::_2);
-      for (; j < end - 4; j += 4)
-        __compute4(j, add_func2);
-      for (; j < end; ++j)
-        __compute1(j, add_func2s);
+    VOLE_TRACE("lpn_task", start);
+    int indices[kRowBlock * d];
+    for (int j = start; j < end; j += kRowBlock) {
+      int rows = std::min(kRowBlock, end - j);
+      {
+        VOLE_PHASE(VOLE_PHASE_LPN_INDEX);
+        blake3_indices(j, rows, indices);
+      }
+      VOLE_PHASE(VOLE_PHASE_LPN_GATHER);
+      if (party == 1 && K64 != nullptr)
+        fp61_lpn_send_rows_u64(K64 + j, preK64, indices, rows, d);
+      else if (party == 1)
+        fp61_lpn_send_rows((uint64_t *)(K + j), (const uint64_t *)preK,
+                           indices, rows, d);
+      else if (MX != nullptr)
+        fp61_lpn_recv_rows_soa(MX + j, MZ + j, preMX, preMZ, indices, rows, d);
+      else
+        fp61_lpn_recv_rows((uint64_t *)(M + j), (const uint64_t *)preM,
+                           indices, rows, d);
     }
+    VOLE_COUNT(VOLE_COUNT_LPN_ROWS, end - start);
   }
 
   void compute() {
+    VOLE_TRACE("lpn", Stage::fixed ? (int)Stage::n : this->n);
     vector<std::future<void>> fut;
+    const int n = Stage::fixed ? (int)Stage::n : this->n;
     int width = n / (threads + 1);
     for (int i = 0; i < threads; ++i) {
       int start = i * width;
@@ -200,6 +148,14 @@ public:
     this->party = ALICE;
     this->K = K;
     this->preK = kkK;
+    this->K64 = nullptr;
+    compute();
+  }
+
+  void compute_send(uint64_t *K, const uint64_t *kkK) {
+    this->party = ALICE;
+    this->K64 = K;
+    this->preK64 = kkK;
     compute();
   }
 
@@ -207,6 +163,17 @@ public:
     this->party = BOB;
     this->M = M;
     this->preM = kkM;
+    this->MX = nullptr;
+    compute();
+  }
+
+  void compute_recv(uint64_t *X, uint64_t *Z, const uint64_t *kkX,
+                    const uint64_t *kkZ) {
+    this->party = BOB;
+    this->MX = X;
+    this->MZ = Z;
+    this->preMX = kkX;
+    this->preMZ = kkZ;
     compute();
   }
 };
@@ -0,0 +1,332 @@
+#ifndef LPN_PARAM_FP_BLAKE3_H__
+#define LPN_PARAM_FP_BLAKE3_H__
+
+// Primal-LPN parameter sets for VoleTripleBlake3 and a selection engine that
+// picks (or derives) a set for a target output count, memory budget and
+// security level.
+//
+// Security heuristic: every shipped 128-bit set keeps k >= 76 * 2^log_bin_sz
+// (equivalently k * t / n >= 76) at each of the three stages, which is the
+// ratio governing the Gaussian-elimination style attacks on regular-noise
+// primal LPN. Derived sets scale that ratio linearly with the requested
+// security level and also require t >= security bits.
+
+#include "emp-zk/emp-vole/utility.h"
+#include <cstdio>
+#include <cstring>
+
+// Pre-VOLEs each MPFSS run takes after its t tree keys as masks of the
+// malicious check, one per independent challenge (MpfssRegFpBlake3)
+const int64_t kMpfssCheckMasks = 3;
+
+class PrimalLPNParameterFp61Blake3 {
+public:
+  int64_t n, t, k, log_bin_sz;
+  int64_t n_pre, t_pre, k_pre, log_bin_sz_pre;
+  int64_t n_pre0, t_pre0, k_pre0, log_bin_sz_pre0;
+
+  PrimalLPNParameterFp61Blake3() {}
+  PrimalLPNParameterFp61Blake3(int64_t n, int64_t t, int64_t k, int64_t log_bin_sz,
+                               int64_t n_pre, int64_t t_pre, int64_t k_pre,
+                               int64_t log_bin_sz_pre, int64_t n_pre0, int64_t t_pre0,
+                               int64_t k_pre0, int64_t log_bin_sz_pre0)
+      : n(n), t(t), k(k), log_bin_sz(log_bin_sz), n_pre(n_pre), t_pre(t_pre),
+        k_pre(k_pre), log_bin_sz_pre(log_bin_sz_pre), n_pre0(n_pre0),
+        t_pre0(t_pre0), k_pre0(k_pre0), log_bin_sz_pre0(log_bin_sz_pre0) {
+
+    if (n != t * (1 << log_bin_sz) || n_pre != t_pre * (1 << log_bin_sz_pre) ||
+        n_pre < k + t + kMpfssCheckMasks)
+      error("LPN parameter not matched");
+  }
+  int64_t buf_sz() const { return n - t - k - kMpfssCheckMasks; }
+
+  // Number of mock base sVOLEs consumed by the first bootstrapping stage
+  int64_t base_voles() const { return kMpfssCheckMasks + t_pre0 + k_pre0; }
+};
+
+const static PrimalLPNParameterFp61Blake3 fp_default_blake3 = PrimalLPNParameterFp61Blake3(
+    10168320, 4965, 158000, 11, 166400, 2600, 5060, 6, 9600, 600, 1220, 4);
+
+// ~2.6M VOLEs per round, ~45 MB receiver working set
+const static PrimalLPNParameterFp61Blake3 fp_medium_blake3 = PrimalLPNParameterFp61Blake3(
+    2662400, 2600, 78000, 10, 80640, 1260, 5060, 6, 6336, 396, 1220, 4);
+
+// ~1M VOLEs per round, ~18 MB receiver working set
+const static PrimalLPNParameterFp61Blake3 fp_low_blake3 = PrimalLPNParameterFp61Blake3(
+    1048576, 2048, 39000, 9, 41088, 642, 5060, 6, 5712, 357, 1220, 4);
+
+// ~240K VOLEs per round, ~5 MB receiver working set
+const static PrimalLPNParameterFp61Blake3 fp_tiny_blake3 = PrimalLPNParameterFp61Blake3(
+    262144, 1024, 19500, 8, 20544, 321, 5060, 6, 5392, 337, 1220, 4);
+
+// Compile-time parameter sets. A stage type fixes (n, t, k, log_bin_sz) of
+// one LPN stage so the SPFSS, MPFSS and LPN classes templated on it can size
+// scratch statically and unroll the GGM levels. LpnStageDynamic keeps the
+// sizes as runtime fields.
+struct LpnStageDynamic {
+  static constexpr bool fixed = false;
+  static constexpr int64_t n = 0, t = 0, k = 0;
+  static constexpr int log_bin_sz = 0;
+  static constexpr int depth = 0;
+};
+
+template <int64_t N, int64_t T, int64_t K, int LogBinSz> struct LpnStageFixed {
+  static_assert(N == (T << LogBinSz), "n must equal t * 2^log_bin_sz");
+  static_assert(K > 0 && T > 0, "empty LPN stage");
+  static constexpr bool fixed = true;
+  static constexpr int64_t n = N, t = T, k = K;
+  static constexpr int log_bin_sz = LogBinSz;
+  static constexpr int depth = LogBinSz + 1;
+};
+
+struct LpnParamDynamic {
+  static constexpr bool fixed = false;
+  typedef LpnStageDynamic final_stage, pre_stage, pre0_stage;
+};
+
+template <typename Final, typename Pre, typename Pre0> struct LpnParamFixed {
+  static_assert(Pre::n >= Final::k + Final::t + kMpfssCheckMasks,
+                "stage 1 too small");
+  static_assert(Pre0::n >= Pre::k + Pre::t + kMpfssCheckMasks,
+                "stage 0 too small");
+  static constexpr bool fixed = true;
+  typedef Final final_stage;
+  typedef Pre pre_stage;
+  typedef Pre0 pre0_stage;
+
+  static PrimalLPNParameterFp61Blake3 runtime() {
+    return PrimalLPNParameterFp61Blake3(
+        Final::n, Final::t, Final::k, Final::log_bin_sz, Pre::n, Pre::t,
+        Pre::k, Pre::log_bin_sz, Pre0::n, Pre0::t, Pre0::k, Pre0::log_bin_sz);
+  }
+};
+
+// Compile-time twins of the precomputed sets below
+typedef LpnParamFixed<LpnStageFixed<10168320, 4965, 158000, 11>,
+                      LpnStageFixed<166400, 2600, 5060, 6>,
+                      LpnStageFixed<9600, 600, 1220, 4>>
+    FpDefaultBlake3Fixed;
+typedef LpnParamFixed<LpnStageFixed<2662400, 2600, 78000, 10>,
+                      LpnStageFixed<80640, 1260, 5060, 6>,
+                      LpnStageFixed<6336, 396, 1220, 4>>
+    FpMediumBlake3Fixed;
+typedef LpnParamFixed<LpnStageFixed<1048576, 2048, 39000, 9>,
+                      LpnStageFixed<41088, 642, 5060, 6>,
+                      LpnStageFixed<5712, 357, 1220, 4>>
+    FpLowBlake3Fixed;
+typedef LpnParamFixed<LpnStageFixed<262144, 1024, 19500, 8>,
+                      LpnStageFixed<20544, 321, 5060, 6>,
+                      LpnStageFixed<5392, 337, 1220, 4>>
+    FpTinyBlake3Fixed;
+
+// Call f with a value of the fixed parameter type named `profile`; returns
+// false if no fixed type exists for that name
+template <typename F> bool with_fixed_profile_fp61(const char *profile, F &&f) {
+  if (strcmp(profile, "default") == 0)
+    f(FpDefaultBlake3Fixed());
+  else if (strcmp(profile, "medium") == 0)
+    f(FpMediumBlake3Fixed());
+  else if (strcmp(profile, "low") == 0)
+    f(FpLowBlake3Fixed());
+  else if (strcmp(profile, "tiny") == 0)
+    f(FpTinyBlake3Fixed());
+  else
+    return false;
+  return true;
+}
+
+struct LPNProfileFp61Blake3 {
+  const char *name;
+  int security;
+  const PrimalLPNParameterFp61Blake3 *param;
+};
+
+// Precomputed sets, largest first
+const static LPNProfileFp61Blake3 fp_blake3_profiles[] = {
+    {"default", 128, &fp_default_blake3},
+    {"medium", 128, &fp_medium_blake3},
+    {"low", 128, &fp_low_blake3},
+    {"tiny", 128, &fp_tiny_blake3},
+};
+const static int fp_blake3_profile_n =
+    sizeof(fp_blake3_profiles) / sizeof(fp_blake3_profiles[0]);
+
+inline const PrimalLPNParameterFp61Blake3 *lpn_profile_fp61(const char *name) {
+  for (int i = 0; i < fp_blake3_profile_n; ++i)
+    if (strcmp(fp_blake3_profiles[i].name, name) == 0)
+      return fp_blake3_profiles[i].param;
+  return nullptr;
+}
+
+// Minimum k / 2^log_bin_sz for the given security level
+inline int64_t lpn_min_k_per_bin(int security) {
+  return (76 * (int64_t)security + 127) / 128;
+}
+
+// Security level (bits) supported by a parameter set under the heuristic
+// above, taking the weakest of the three stages
+inline int lpn_security_fp61(const PrimalLPNParameterFp61Blake3 &p) {
+  int64_t ratio = p.k / (1LL << p.log_bin_sz);
+  ratio = std::min(ratio, p.k_pre / ((int64_t)1 << p.log_bin_sz_pre));
+  ratio = std::min(ratio, p.k_pre0 / ((int64_t)1 << p.log_bin_sz_pre0));
+  int64_t bits = ratio * 128 / 76;
+  bits = std::min(bits, std::min(p.t, std::min(p.t_pre, p.t_pre0)));
+  return (int)bits;
+}
+
+// Structural checks on all three stages (the constructor only checks some)
+inline bool lpn_param_valid_fp61(const PrimalLPNParameterFp61Blake3 &p) {
+  if (p.log_bin_sz < 1 || p.log_bin_sz_pre < 1 || p.log_bin_sz_pre0 < 1)
+    return false;
+  if (p.n != p.t * (1LL << p.log_bin_sz) ||
+      p.n_pre != p.t_pre * (1LL << p.log_bin_sz_pre) ||
+      p.n_pre0 != p.t_pre0 * (1LL << p.log_bin_sz_pre0))
+    return false;
+  // Each stage must produce the k + t + kMpfssCheckMasks correlations the
+  // next one consumes
+  return p.n_pre >= p.k + p.t + kMpfssCheckMasks &&
+         p.n_pre0 >= p.k_pre + p.t_pre + kMpfssCheckMasks &&
+         p.buf_sz() > 0;
+}
+
+// Storage choices of one party that change its working set
+struct VoleLayoutFp61 {
+  int party = BOB;
+  bool caller_output = true;   // one round of outputs held by the caller
+  bool round_buffer = false;   // extend(data, num) keeps a round buffer
+  bool compact_sender = false; // ALICE: 64-bit outputs and pre-VOLEs
+  bool soa_receiver = false;   // BOB: x and z words in two arrays
+  bool dual_ea = false;        // p is an ea_param_fp61 set
+};
+
+// Bytes of OTPre data and GGM level messages for t trees of 2^log_bin_sz
+inline int64_t lpn_tree_memory_fp61(int64_t t, int64_t log_bin_sz, int party) {
+  int64_t ots = t * log_bin_sz;
+  return 32 * ots + ots / 8 + 16 * ots * (party == ALICE ? 2 : 1);
+}
+
+// Peak working set of one party in bytes: the larger of setup (stage 0
+// and 1 outputs, stage 1 trees, the final stage's trees allocated
+// alongside, the copy into split or compact pre-VOLEs) and extend (the
+// caller's round, the round buffer, the carried pre-VOLEs, the final
+// stage's trees and the dual-LPN noise)
+inline int64_t lpn_memory_fp61(const PrimalLPNParameterFp61Blake3 &p,
+                               const VoleLayoutFp61 &l = VoleLayoutFp61()) {
+  int64_t word = l.compact_sender ? 8 : 16;
+  int64_t final_trees = lpn_tree_memory_fp61(p.t, p.log_bin_sz, l.party);
+  int64_t noise = l.dual_ea ? 8 * (p.t << p.log_bin_sz) : 0;
+  int64_t carry = l.dual_ea ? 16 * p.n_pre0 : word * p.n_pre;
+  int64_t setup = 16 * p.n_pre0 + final_trees + noise;
+  if (!l.dual_ea) {
+    setup += 16 * p.n_pre +
+             lpn_tree_memory_fp61(p.t_pre, p.log_bin_sz_pre, l.party);
+    if (l.compact_sender || l.soa_receiver)
+      setup += word * p.n_pre;
+  }
+  int64_t extend = carry + final_trees + noise;
+  if (l.caller_output)
+    extend += word * p.n;
+  if (l.round_buffer)
+    extend += word * p.n;
+  return std::max(setup, extend);
+}
+
+// Build all three stages around a final stage with 2^log_bin_sz-sized bins
+// that yields at least `outputs` VOLEs per round
+inline PrimalLPNParameterFp61Blake3
+lpn_derive_fp61(int64_t outputs, int log_bin_sz, int security) {
+  const int log_bin_pre = 6, log_bin_pre0 = 4;
+  int64_t c = lpn_min_k_per_bin(security);
+  int64_t bin = 1LL << log_bin_sz;
+  int64_t k = c * bin;
+  // n - t = t * (bin - 1) must cover outputs + k + kMpfssCheckMasks
+  int64_t t = (outputs + k + kMpfssCheckMasks + bin - 2) / (bin - 1);
+  t = std::max(t, (int64_t)security);
+
+  int64_t k_pre = c << log_bin_pre;
+  int64_t t_pre =
+      (k + t + kMpfssCheckMasks + (1LL << log_bin_pre) - 1) >> log_bin_pre;
+  t_pre = std::max(t_pre, (int64_t)security);
+
+  int64_t k_pre0 = c << log_bin_pre0;
+  int64_t t_pre0 = (k_pre + t_pre + kMpfssCheckMasks +
+                    (1LL << log_bin_pre0) - 1) >> log_bin_pre0;
+  t_pre0 = std::max(t_pre0, (int64_t)security);
+
+  return PrimalLPNParameterFp61Blake3(
+      t * bin, t, k, log_bin_sz, t_pre << log_bin_pre, t_pre, k_pre,
+      log_bin_pre, t_pre0 << log_bin_pre0, t_pre0, k_pre0, log_bin_pre0);
+}
+
+// Choose parameters for `target_outputs` VOLEs within `mem_budget` bytes of
+// one party's working set (lpn_memory_fp61 with layout l) at `security`
+// bits. Precomputed sets and sets derived for log_bin_sz in [6, 11] compete
+// on total LPN rows processed (rounds * n plus setup); ties go to the
+// smaller working set. Derived sets cover the target in one round, or take
+// the largest round that fits. Returns false if nothing fits the budget.
+inline bool lpn_select_fp61(int64_t target_outputs, int64_t mem_budget,
+                            int security, PrimalLPNParameterFp61Blake3 *out,
+                            const char **name = nullptr,
+                            const VoleLayoutFp61 &l = VoleLayoutFp61()) {
+  bool found = false;
+  int64_t best_work = 0, best_mem = 0;
+  auto consider = [&](const PrimalLPNParameterFp61Blake3 &p, const char *nm) {
+    if (!lpn_param_valid_fp61(p) || lpn_security_fp61(p) < security)
+      return;
+    int64_t mem = lpn_memory_fp61(p, l);
+    if (mem > mem_budget)
+      return;
+    int64_t rounds = (target_outputs + p.buf_sz() - 1) / p.buf_sz();
+    int64_t work = std::max(rounds, (int64_t)1) * p.n + p.n_pre + p.n_pre0;
+    if (!found || work < best_work || (work == best_work && mem < best_mem)) {
+      found = true;
+      best_work = work;
+      best_mem = mem;
+      *out = p;
+      if (name != nullptr)
+        *name = nm;
+    }
+  };
+  for (int i = 0; i < fp_blake3_profile_n; ++i)
+    consider(*fp_blake3_profiles[i].param, fp_blake3_profiles[i].name);
+  for (int b = 6; b <= 11; ++b) {
+    // Largest round in [1, target] within the budget; memory grows with
+    // the round size
+    auto fits = [&](int64_t outputs) {
+      return lpn_memory_fp61(lpn_derive_fp61(outputs, b, security), l) <=
+             mem_budget;
+    };
+    int64_t lo = 0, hi = target_outputs;
+    while (lo < hi) {
+      int64_t mid = lo + (hi - lo + 1) / 2;
+      if (fits(mid))
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    if (lo > 0)
+      consider(lpn_derive_fp61(lo, b, security), "derived");
+  }
+  return found;
+}
+
+// A profile name, or "select:TARGET:BUDGET_MB" for the lpn_select_fp61
+// choice at 128 bits for a receiver with the default layout, so that both
+// parties derive the same set from the same string
+inline bool lpn_param_lookup_fp61(const char *spec,
+                                  PrimalLPNParameterFp61Blake3 *out) {
+  const PrimalLPNParameterFp61Blake3 *p = lpn_profile_fp61(spec);
+  if (p != nullptr) {
+    *out = *p;
+    return true;
+  }
+  long long target = 0;
+  double budget_mb = 0;
+  char tail;
+  if (sscanf(spec, "select:%lld:%lf%c", &target, &budget_mb, &tail) != 2 ||
+      target <= 0 || budget_mb <= 0)
+    return false;
+  return lpn_select_fp61(target, (int64_t)(budget_mb * 1048576), 128, out);
+}
+
+#endif // LPN_PARAM_FP_BLAKE3_H__
@@ -5,6 +5,7 @@
 
 // Note: preot and emp-tool included via emp-vole-mock.h
 #include "emp-zk/emp-vole/utility.h"
+#include "emp-zk/emp-vole/lpn_param_blake3.h"
 #include "emp-zk/emp-vole/spfss_sender_blake3.h"
 #include "emp-zk/emp-vole/spfss_recver_blake3.h"
 // preot_blake3.h provides OTPre
@@ -12,14 +13,48 @@
 
 using namespace emp;
 
-template <typename IO> class MpfssRegFpBlake3 {
+// Fiat-Shamir mode of the malicious check, shared by the MPFSS objects of
+// all stages. Check seeds come from a running BLAKE3 hash of the messages
+// exchanged so far (random-oracle challenge) instead of a seed_expand
+// flight. A run's x_star -> H(v) exchange is deferred: it rides on the
+// first flights of the next run, or on finish_check() before the outputs
+// are handed out.
+//
+// ALICE sees the choice bits before her tree messages go into the hash, so
+// she can redraw tree seeds offline until a challenge accepts bad trees.
+// One challenge passes such trees with probability leave_n / p (about
+// 2^-50); the mode runs kMpfssCheckMasks independent challenges, each with
+// its own mask, so an attempt passes with about 2^-150.
+struct MpfssFsState {
+  block chain = zero_block; // transcript hash so far
+  bool pending = false;     // a check still awaits its exchange
+  uint64_t x_star[kMpfssCheckMasks] = {}; // BOB
+  uint64_t v[kMpfssCheckMasks] = {};      // BOB: va; ALICE: sum of the V_i
+  uint64_t y[kMpfssCheckMasks] = {};      // ALICE
+  uint64_t delta = 0;                     // ALICE
+};
+
+// Stage is an LpnStageFixed<...> to build the trees with compile-time depth,
+// or LpnStageDynamic to take (n, t, log_bin_sz) at runtime
+// Prp selects the SPFSS tree expansion (TwoKeyPRP_Blake3 or
+// HalfTreePRP_Blake3), identical for both parties.
+template <typename IO, typename Stage = LpnStageDynamic,
+          typename Prp = TwoKeyPRP_Blake3>
+class MpfssRegFpBlake3 {
 public:
+  typedef SpfssSenderFpBlake3<IO, Stage::depth, Prp> Sender;
+  typedef SpfssRecverFpBlake3<IO, Stage::depth, Prp> Recver;
+
   int party;
   int threads;
   int item_n, idx_max, m;
   int tree_height, leave_n;
   int tree_n;
   bool is_malicious;
+  // Independent challenges of the malicious check: one with a seed from
+  // BOB, kMpfssCheckMasks with Fiat-Shamir seeds. Check c of a run is
+  // masked by base VOLE tree_n + c.
+  int check_n = 1;
 
   PRG prg;
   IO *netio;
@@ -30,9 +65,35 @@ public:
   __uint128_t *triple_yz;
   ThreadPool *pool;
   std::vector<uint32_t> item_pos_recver;
+  MpfssFsState *fs = nullptr;
+  // Arena: tree state of all runs, allocated once and reused by every
+  // mpfss() call. The OT messages and choice bits of a runtime depth live in
+  // flat arrays; the check scratch has one slot per worker.
+  Sender *senders = nullptr;
+  Recver *recvers = nullptr;
+  std::vector<block> tree_m;
+  bool *tree_b = nullptr;
+  std::vector<block> tree_seed;
+  std::vector<block> check_seed;
+  std::vector<__uint128_t> check_chi;
+  // Compact sender storage (set_compact_sender): keys and the sparse vector
+  // hold one 64-bit word per element; each worker expands its trees in a
+  // tree_scratch slot and packs the leaves into sparse_y64
+  const uint64_t *triple_y64 = nullptr;
+  uint64_t *sparse_y64 = nullptr;
+  std::vector<__uint128_t> tree_scratch;
+  // Split receiver storage (set_soa_receiver): keys and the sparse vector
+  // keep their x and z words in separate arrays, packed the same way
+  const uint64_t *triple_x64 = nullptr, *triple_z64 = nullptr;
+  uint64_t *sparse_x64 = nullptr, *sparse_z64 = nullptr;
+  // Set by prepare(): the OTPre whose choice flight already went out
+  OTPre<IO> *prepared = nullptr;
 
   MpfssRegFpBlake3(int party, int threads, int n, int t, int log_bin_sz,
                    ThreadPool *pool, IO **ios) {
+    if (Stage::fixed && (n != Stage::n || t != Stage::t ||
+                         log_bin_sz != Stage::log_bin_sz))
+      error("MPFSS size does not match the fixed parameter set");
     this->party = party;
     this->threads = threads;
     this->netio = ios[0];
@@ -50,12 +111,39 @@ public:
     this->ggm_tree =
         (__uint128_t **)malloc(this->item_n * sizeof(__uint128_t *));
 
+    // Check values of tree i and challenge c at i * kMpfssCheckMasks + c
     if (party == BOB)
-      check_chialpha_buf = new __uint128_t[item_n];
-    check_VW_buf = new __uint128_t[item_n];
+      check_chialpha_buf = new __uint128_t[item_n * kMpfssCheckMasks];
+    check_VW_buf = new __uint128_t[item_n * kMpfssCheckMasks];
+
+    int levels = tree_height - 1;
+    if (Stage::depth == 0)
+      tree_m.resize((size_t)tree_n * levels * (party == ALICE ? 2 : 1));
+    if (party == ALICE) {
+      senders = new Sender[tree_n];
+      tree_seed.resize(tree_n);
+      for (int i = 0; i < tree_n; ++i)
+        senders[i].initialization(
+            netio, tree_height,
+            Stage::depth == 0 ? &tree_m[(size_t)i * 2 * levels] : nullptr);
+    } else {
+      recvers = new Recver[tree_n];
+      if (Stage::depth == 0)
+        tree_b = new bool[(size_t)tree_n * levels];
+      for (int i = 0; i < tree_n; ++i)
+        recvers[i].initialization(
+            netio, tree_height,
+            Stage::depth == 0 ? &tree_m[(size_t)i * levels] : nullptr,
+            Stage::depth == 0 ? tree_b + (size_t)i * levels : nullptr);
+    }
+    check_seed.resize(threads * kMpfssCheckMasks);
+    check_chi.resize((size_t)threads * kMpfssCheckMasks * leave_n);
   }
 
   ~MpfssRegFpBlake3() {
+    delete[] senders;
+    delete[] recvers;
+    delete[] tree_b;
     free(ggm_tree);
     if (check_chialpha_buf != nullptr)
       delete[] check_chialpha_buf;
@@ -64,13 +152,47 @@ public:
 
   void set_malicious() { is_malicious = true; }
 
+  // Fiat-Shamir checks (see MpfssFsState); both parties must agree
+  void set_fiat_shamir(MpfssFsState *state) {
+    fs = state;
+    check_n = kMpfssCheckMasks;
+  }
+
   void sender_init(__uint128_t delta) { secret_share_x = delta; }
 
+  // ALICE only: enables mpfss() over packed 64-bit keys and outputs
+  void set_compact_sender() {
+    if (party != ALICE)
+      error("Only the sender has 64-bit outputs");
+    tree_scratch.resize((size_t)threads * leave_n);
+  }
+
+  // BOB only: enables mpfss() over split x/z keys and outputs
+  void set_soa_receiver() {
+    if (party != BOB)
+      error("Only the receiver has split x/z outputs");
+    tree_scratch.resize((size_t)threads * leave_n);
+  }
+
+  // Base VOLE key i, from whichever storage this run uses
+  __uint128_t key(int i) const {
+    if (triple_y64 != nullptr)
+      return (__uint128_t)triple_y64[i];
+    if (triple_z64 != nullptr)
+      return ((__uint128_t)triple_x64[i] << 64) | triple_z64[i];
+    return triple_yz[i];
+  }
+
   void recver_init() { item_pos_recver.resize(this->item_n); }
 
+  // BOB: position of tree i's punctured leaf in the sparse vector
+  int64_t punctured(int i) const {
+    return (int64_t)i * leave_n + item_pos_recver[i] % leave_n;
+  }
+
   void set_vec_x(__uint128_t *out, __uint128_t *in) {
     for (int i = 0; i < tree_n; ++i) {
-      int64_t pt = (int64_t)i * leave_n + ((int64_t)item_pos_recver[i] % leave_n);
+      int64_t pt = punctured(i);
       out[pt] = out[pt] ^ (__uint128_t)makeBlock(in[i], 0x0LL);
     }
   }
@@ -78,117 +200,214 @@ public:
   void mpfss(OTPre<IO> *ot, __uint128_t *triple_yz,
              __uint128_t *sparse_vector) {
     this->triple_yz = triple_yz;
+    this->triple_y64 = nullptr;
+    this->sparse_y64 = nullptr;
+    this->triple_z64 = nullptr;
+    this->sparse_z64 = nullptr;
     mpfss(ot, sparse_vector);
   }
 
+  // Compact sender run: keys and sparse_y hold the low words only
+  void mpfss(OTPre<IO> *ot, const uint64_t *keys, uint64_t *sparse_y) {
+    if (tree_scratch.empty())
+      error("Call set_compact_sender before a 64-bit MPFSS run");
+    this->triple_y64 = keys;
+    this->sparse_y64 = sparse_y;
+    mpfss(ot, (__uint128_t *)nullptr);
+  }
+
+  // Split receiver run: x and z words of the keys and of the sparse vector
+  // in separate arrays. With sparse_x null the x words are not written; the
+  // only nonzero one of tree i is its key's, at punctured(i).
+  void mpfss(OTPre<IO> *ot, const uint64_t *keys_x, const uint64_t *keys_z,
+             uint64_t *sparse_x, uint64_t *sparse_z) {
+    if (tree_scratch.empty())
+      error("Call set_soa_receiver before a split MPFSS run");
+    this->triple_x64 = keys_x;
+    this->triple_z64 = keys_z;
+    this->sparse_x64 = sparse_x;
+    this->sparse_z64 = sparse_z;
+    mpfss(ot, (__uint128_t *)nullptr);
+  }
+
+  // Runs the next run's choice flight into ot ahead of its mpfss() call,
+  // e.g. while the previous run's output goes through LPN. Nothing may use
+  // this object's IO in between; with Fiat-Shamir checks the flight also
+  // settles the previous run's check.
+  void prepare(OTPre<IO> *ot) {
+    choose(ot);
+    prepared = ot;
+  }
+
   void mpfss(OTPre<IO> *ot, __uint128_t *sparse_vector) {
-    vector<SpfssSenderFpBlake3<IO> *> senders;
-    vector<SpfssRecverFpBlake3<IO> *> recvers;
+    VOLE_TRACE("mpfss", tree_n);
     vector<future<void>> fut;
-    for (int i = 0; i < tree_n; ++i) {
-      if (party == 1) {
-        senders.push_back(new SpfssSenderFpBlake3<IO>(netio, tree_height));
-        ot->choices_sender();
-      } else {
-        recvers.push_back(new SpfssRecverFpBlake3<IO>(netio, tree_height));
-        ot->choices_recver(recvers[i]->b);
-        item_pos_recver[i] = recvers[i]->get_index();
-      }
-    }
-    netio->flush();
-    ot->reset();
+    if (prepared != ot)
+      choose(ot);
+    prepared = nullptr;
 
     uint32_t width = tree_n / threads;
     uint32_t start = 0, end = width;
     for (int i = 0; i < threads - 1; ++i) {
-      fut.push_back(pool->enqueue(
-          [this, start, end, width, senders, recvers, ot, sparse_vector]() {
-            for (auto i = start; i < end; ++i) {
-              if (party == ALICE) {
-                ggm_tree[i] = sparse_vector + i * leave_n;
-                senders[i]->compute(ggm_tree[i], secret_share_x, triple_yz[i]);
-                senders[i]->template send<OTPre<IO>>(ot, ios[start / width], i);
-                ios[start / width]->flush();
-              } else {
-                recvers[i]->template recv<OTPre<IO>>(ot, ios[start / width], i);
-                ggm_tree[i] = sparse_vector + i * leave_n;
-                recvers[i]->compute(ggm_tree[i], triple_yz[i]);
-                ios[start / width]->flush();
-              }
-            }
-          }));
+      fut.push_back(pool->enqueue([this, start, end, i, ot, sparse_vector]() {
+        expand_trees(ot, sparse_vector, start, end, i);
+      }));
       start = end;
       end += width;
     }
-    end = tree_n;
-    for (auto i = start; i < end; ++i) {
-      if (party == ALICE) {
-        ggm_tree[i] = sparse_vector + i * leave_n;
-        senders[i]->compute(ggm_tree[i], secret_share_x, triple_yz[i]);
-        senders[i]->template send<OTPre<IO>>(ot, ios[threads - 1], i);
-        ios[threads - 1]->flush();
-      } else {
-        recvers[i]->template recv<OTPre<IO>>(ot, ios[threads - 1], i);
-        ggm_tree[i] = sparse_vector + i * leave_n;
-        recvers[i]->compute(ggm_tree[i], triple_yz[i]);
-        ios[threads - 1]->flush();
-      }
-    }
+    expand_trees(ot, sparse_vector, start, tree_n, threads - 1);
     for (auto &f : fut)
       f.get();
 
     if (is_malicious) {
-      block *seed = new block[threads];
-      seed_expand(seed, threads);
+      VOLE_PHASE(VOLE_PHASE_CHECK);
+      block *seed = check_seed.data();
+      if (fs != nullptr)
+        seed_transcript(seed, threads * check_n, ot);
+      else
+        seed_expand(seed, threads * check_n);
       vector<future<void>> fut;
       uint32_t start = 0, end = width;
       for (int i = 0; i < threads - 1; ++i) {
-        fut.push_back(
-            pool->enqueue([this, start, end, width, senders, recvers, seed]() {
-              for (auto i = start; i < end; ++i) {
-                if (party == ALICE) {
-                  senders[i]->consistency_check_msg_gen(
-                      check_VW_buf[i], ios[start / width], seed[start / width]);
-                } else {
-                  recvers[i]->consistency_check_msg_gen(
-                      check_chialpha_buf[i], check_VW_buf[i],
-                      ios[start / width], triple_yz[i], seed[start / width]);
-                }
-              }
-            }));
+        int t = i;
+        fut.push_back(pool->enqueue([this, start, end, t]() {
+          check_msg_gen(start, end, t);
+        }));
         start = end;
         end += width;
       }
-      end = tree_n;
-      for (auto i = start; i < end; ++i) {
-        if (party == ALICE) {
-          senders[i]->consistency_check_msg_gen(
-              check_VW_buf[i], ios[threads - 1], seed[threads - 1]);
-        } else {
-          recvers[i]->consistency_check_msg_gen(
-              check_chialpha_buf[i], check_VW_buf[i], ios[threads - 1],
-              triple_yz[i], seed[threads - 1]);
-        }
-      }
+      check_msg_gen(start, tree_n, threads - 1);
       for (auto &f : fut)
         f.get();
-      delete[] seed;
     }
 
     if (is_malicious) {
-      if (party == ALICE)
-        consistency_batch_check(triple_yz[tree_n], tree_n);
+      VOLE_PHASE(VOLE_PHASE_CHECK);
+      if (fs != nullptr)
+        defer_batch_check(tree_n);
+      else if (party == ALICE)
+        consistency_batch_check(key(tree_n), tree_n);
       else
-        consistency_batch_check(triple_yz, triple_yz[tree_n], tree_n);
+        recver_batch_check(key(tree_n), tree_n);
     }
+  }
 
-    for (auto p : senders)
-      delete p;
-    for (auto p : recvers)
-      delete p;
+  // The choice flight of a run: tree seeds (ALICE) or punctured positions
+  // (BOB), then the packed choice bits
+  void choose(OTPre<IO> *ot) {
+    if (fs != nullptr)
+      deferred_check_begin();
+    if (party == ALICE)
+      prg.random_block(tree_seed.data(), tree_n);
+    for (int i = 0; i < tree_n; ++i) {
+      if (party == ALICE) {
+        senders[i].seed = tree_seed[i];
+        ot->choices_sender();
+      } else {
+        recvers[i].reseed_choices();
+        ot->choices_recver(recvers[i].b);
+        item_pos_recver[i] = recvers[i].get_index();
+      }
+    }
+    if (party == ALICE)
+      ot->recv_choices();
+    else
+      ot->send_choices();
+    netio->flush();
+    ot->reset();
+    if (fs != nullptr) {
+      deferred_check_end();
+      ot->keep_wire();
+    }
   }
 
-  void seed_expand(block *seed, int threads) {
+  // Trees [start, end) of worker w: GGM expansion and OT messages over ios[w]
+  void expand_trees(OTPre<IO> *ot, __uint128_t *sparse_vector, uint32_t start,
+                    uint32_t end, int w) {
+    IO *io = ios[w];
+    for (auto i = start; i < end; ++i) {
+      if (sparse_y64 != nullptr) {
+        // Leaves come out of compute() reduced with zero high words
+        __uint128_t *tree = tree_scratch.data() + (size_t)w * leave_n;
+        senders[i].compute(tree, secret_share_x, key(i));
+        uint64_t *y = sparse_y64 + (size_t)i * leave_n;
+        for (int l = 0; l < leave_n; ++l)
+          y[l] = (uint64_t)tree[l];
+        senders[i].template send<OTPre<IO>>(ot, io, i);
+        io->flush();
+        continue;
+      }
+      if (sparse_z64 != nullptr) {
+        // The punctured leaf's x word is beta's; every other x word is 0
+        __uint128_t *tree = tree_scratch.data() + (size_t)w * leave_n;
+        recvers[i].template recv<OTPre<IO>>(ot, io, i);
+        recvers[i].compute(tree, key(i));
+        uint64_t *z = sparse_z64 + (size_t)i * leave_n;
+        for (int l = 0; l < leave_n; ++l)
+          z[l] = (uint64_t)tree[l];
+        if (sparse_x64 != nullptr) {
+          uint64_t *x = sparse_x64 + (size_t)i * leave_n;
+          memset(x, 0, leave_n * sizeof(uint64_t));
+          x[item_pos_recver[i] % leave_n] = triple_x64[i];
+        }
+        io->flush();
+        continue;
+      }
+      ggm_tree[i] = sparse_vector + (size_t)i * leave_n;
+      if (party == ALICE) {
+        senders[i].compute(ggm_tree[i], secret_share_x, triple_yz[i]);
+        senders[i].template send<OTPre<IO>>(ot, io, i);
+      } else {
+        recvers[i].template recv<OTPre<IO>>(ot, io, i);
+        recvers[i].compute(ggm_tree[i], triple_yz[i]);
+      }
+      io->flush();
+    }
+  }
+
+  // Coefficients chi[c * leave_n + j] = r_c^(j+1) of each challenge, with
+  // r_c hashed from seeds[c]; as field elements, or as words for packed
+  // storage. All trees of a worker share them.
+  template <typename T> void check_coeffs(T *chi, const block *seeds) {
+    for (int c = 0; c < check_n; ++c) {
+      Hash hash;
+      T digest = mod(
+          _mm_extract_epi64(hash.hash_for_block(&seeds[c], sizeof(block)), 0));
+      uni_hash_coeff_gen(chi + (size_t)c * leave_n, digest, leave_n);
+    }
+  }
+
+  // Check messages of trees [start, end) with worker t's seeds and scratch
+  void check_msg_gen(uint32_t start, uint32_t end, int t) {
+    __uint128_t *chi =
+        check_chi.data() + (size_t)t * kMpfssCheckMasks * leave_n;
+    uint64_t *chi64 = (uint64_t *)chi;
+    const block *seeds = check_seed.data() + (size_t)t * check_n;
+    bool packed = sparse_y64 != nullptr || sparse_z64 != nullptr;
+    if (packed)
+      check_coeffs(chi64, seeds);
+    else
+      check_coeffs(chi, seeds);
+    for (auto i = start; i < end; ++i) {
+      __uint128_t *vw = check_VW_buf + (size_t)i * kMpfssCheckMasks;
+      __uint128_t *chialpha =
+          party == BOB ? check_chialpha_buf + (size_t)i * kMpfssCheckMasks
+                       : nullptr;
+      if (sparse_y64 != nullptr)
+        senders[i].consistency_check_msg_gen(vw, chi64, check_n,
+                                             sparse_y64 + (size_t)i * leave_n);
+      else if (sparse_z64 != nullptr)
+        recvers[i].consistency_check_msg_gen(chialpha, vw, chi64, check_n,
+                                             sparse_z64 + (size_t)i * leave_n);
+      else if (party == ALICE)
+        senders[i].consistency_check_msg_gen(vw, chi, check_n);
+      else
+        recvers[i].consistency_check_msg_gen(chialpha, vw, triple_yz[i], chi,
+                                             check_n);
+    }
+  }
+
+  void seed_expand(block *seed, int num) {
     block sd = zero_block;
     if (party == ALICE) {
       netio->recv_data(&sd, sizeof(block));
@@ -198,7 +417,104 @@ public:
       netio->flush();
     }
     PRG prg2(&sd);
-    prg2.random_block(seed, threads);
+    prg2.random_block(seed, num);
+  }
+
+  // Check seeds from the transcript: the previous chain value, this run's
+  // choice bits, OT pads and SPFSS sums. Both parties hash the same bytes.
+  void seed_transcript(block *seed, int num, OTPre<IO> *ot) {
+    Hash hash;
+    hash.put(&fs->chain, sizeof(block));
+    hash.put(&tree_n, sizeof(tree_n));
+    hash.put(&tree_height, sizeof(tree_height));
+    hash.put(ot->bits, (int)packed_bytes(ot->n));
+    hash.put(ot->wire.data(), (int)(ot->wire.size() * sizeof(block)));
+    for (int i = 0; i < tree_n; ++i) {
+      uint64_t sum = party == ALICE ? senders[i].secret_sum : recvers[i].share;
+      hash.put(&sum, sizeof(uint64_t));
+    }
+    uint8_t dgst[32];
+    hash.digest(dgst);
+    memcpy(&fs->chain, dgst, sizeof(block));
+    PRG prg2(&fs->chain);
+    prg2.random_block(seed, num);
+  }
+
+  // Keeps this run's batch checks, one per challenge, for the next flight
+  // instead of running them
+  void defer_batch_check(int num) {
+    for (int c = 0; c < check_n; ++c) {
+      if (party == ALICE) {
+        uint64_t vw = 0;
+        for (int i = 0; i < num; ++i)
+          vw = add_mod(vw, (uint64_t)check_VW_buf[i * kMpfssCheckMasks + c]);
+        fs->y[c] = (uint64_t)key(tree_n + c);
+        fs->v[c] = vw;
+      } else {
+        batch_check_values(key(tree_n + c), num, c, fs->x_star[c], fs->v[c]);
+      }
+    }
+    if (party == ALICE)
+      fs->delta = (uint64_t)secret_share_x;
+    fs->pending = true;
+  }
+
+  // First half of a deferred check: BOB sends the x_star values ahead of
+  // the choice bits, ALICE answers with H(vb) over all challenges before
+  // reading them
+  void deferred_check_begin() {
+    if (!fs->pending)
+      return;
+    if (party == ALICE) {
+      uint64_t x_star[kMpfssCheckMasks], vb[kMpfssCheckMasks];
+      netio->recv_data(x_star, sizeof(x_star));
+      for (int c = 0; c < kMpfssCheckMasks; ++c) {
+        uint64_t tmp = add_mod(fs->y[c], mult_mod(fs->delta, x_star[c]));
+        vb[c] = add_mod((uint64_t)(pr - tmp), fs->v[c]);
+      }
+      Hash hash;
+      block h = hash.hash_for_block(vb, sizeof(vb));
+      netio->send_data(&h, sizeof(block));
+      absorb_check(x_star, h);
+      fs->pending = false;
+    } else {
+      netio->send_data(fs->x_star, sizeof(fs->x_star));
+    }
+  }
+
+  // Second half: BOB reads H(vb) and compares it with H(va)
+  void deferred_check_end() {
+    if (!fs->pending || party == ALICE)
+      return;
+    block r;
+    netio->recv_data(&r, sizeof(block));
+    Hash hash;
+    block h = hash.hash_for_block(fs->v, sizeof(fs->v));
+    if (!cmpBlock(&r, &h, 1))
+      error("MPFSS batch check fails");
+    absorb_check(fs->x_star, r);
+    fs->pending = false;
+  }
+
+  void absorb_check(const uint64_t *x_star, block h) {
+    Hash hash;
+    hash.put(&fs->chain, sizeof(block));
+    hash.put(x_star, kMpfssCheckMasks * sizeof(uint64_t));
+    hash.put(&h, sizeof(block));
+    uint8_t dgst[32];
+    hash.digest(dgst);
+    memcpy(&fs->chain, dgst, sizeof(block));
+  }
+
+  // Settles a deferred check on its own round trip; run before the output of
+  // the last MPFSS run is used
+  void finish_check() {
+    if (fs == nullptr || !fs->pending)
+      return;
+    VOLE_PHASE(VOLE_PHASE_CHECK);
+    deferred_check_begin();
+    netio->flush();
+    deferred_check_end();
   }
 
   void consistency_batch_check(__uint128_t y, int num) {
@@ -209,28 +525,36 @@ public:
     uint64_t vb = pr - tmp;
 
     for (int i = 0; i < num; ++i)
-      vb = add_mod(vb, (uint64_t)check_VW_buf[i]);
+      vb = add_mod(vb, (uint64_t)check_VW_buf[i * kMpfssCheckMasks]);
     Hash hash;
     block h = hash.hash_for_block(&vb, sizeof(uint64_t));
     netio->send_data(&h, sizeof(block));
     netio->flush();
   }
 
-  void consistency_batch_check(__uint128_t *delta2, __uint128_t z, int num) {
+  // BOB's side of batch check c: x_star for ALICE and the local va, with
+  // the x words of the run's keys and mask z
+  void batch_check_values(__uint128_t z, int num, int c, uint64_t &x_star,
+                          uint64_t &va) {
     uint64_t beta_mul_chialpha = (uint64_t)0;
     for (int i = 0; i < num; ++i) {
-      uint64_t tmp = mult_mod(_mm_extract_epi64((block)delta2[i], 1),
-                              check_chialpha_buf[i]);
+      uint64_t tmp = mult_mod((uint64_t)(key(i) >> 64),
+                              check_chialpha_buf[i * kMpfssCheckMasks + c]);
       beta_mul_chialpha = add_mod(beta_mul_chialpha, tmp);
     }
-    uint64_t x_star = PR - beta_mul_chialpha;
+    x_star = PR - beta_mul_chialpha;
     x_star = add_mod(_mm_extract_epi64((block)z, 1), x_star);
-    netio->send_data(&x_star, sizeof(uint64_t));
-    netio->flush();
 
-    uint64_t va = PR - _mm_extract_epi64((block)z, 0);
+    va = PR - _mm_extract_epi64((block)z, 0);
     for (int i = 0; i < num; ++i)
-      va = mod(va + check_VW_buf[i], pr);
+      va = mod(va + check_VW_buf[i * kMpfssCheckMasks + c], pr);
+  }
+
+  void recver_batch_check(__uint128_t z, int num) {
+    uint64_t x_star, va;
+    batch_check_values(z, num, 0, x_star, va);
+    netio->send_data(&x_star, sizeof(uint64_t));
+    netio->flush();
 
     Hash hash;
     block h = hash.hash_for_block(&va, sizeof(uint64_t));
@@ -6,17 +6,17 @@
 
 #include <cstring>
 #include <vector>
+#include "emp-zk/emp-vole/bit_pack.h"
+#include "emp-zk/emp-vole/blake3_batch.h"
 
 namespace emp {
 
-// Forward declare Hash (provided by hash_blake3.h)
-class Hash;
-
 template <typename IO> class OTPre {
 public:
   IO *io;
   block *pre_data = nullptr;
-  bool *bits = nullptr;
+  // Choice bits, packed (bit_pack.h); the choice message is this array
+  uint8_t *bits = nullptr;
   int n;
   std::vector<block *> pointers;
   std::vector<const bool *> choices;
@@ -25,13 +25,16 @@ public:
 
   int length, count;
   block Delta;
+  // Pads sent or received, 2 per OT, once keep_wire() was called
+  // (Fiat-Shamir transcript of MpfssRegFpBlake3)
+  std::vector<block> wire;
 
   OTPre(IO *io, int length, int times) {
     this->io = io;
     this->length = length;
     n = length * times;
     pre_data = new block[2 * n];
-    bits = new bool[n];
+    bits = new uint8_t[packed_bytes(n)]();
     count = 0;
   }
 
@@ -42,29 +45,16 @@ public:
       delete[] bits;
   }
 
-  // Hash n blocks using BLAKE3 (replaces CCRH.Hn)
+  // Hash n blocks using BLAKE3 (replaces CCRH.Hn); index for domain
+  // separation, all lanes of blake3_hash_many at once
   void hash_blocks(block *out, const block *in, int start, int num) {
-    Hash hash;
-    for (int i = 0; i < num; ++i) {
-      hash.reset();
-      // Include index for domain separation
-      uint64_t idx = start + i;
-      hash.put(&idx, sizeof(idx));
-      hash.put(&in[i], sizeof(block));
-      hash.digest(out + i);
-    }
+    blake3_crh16_batch(out, in, nullptr, start, num);
   }
 
-  // Hash with additional XOR data (for sender path)
-  void hash_blocks_with_delta(block *out, const block *in, int start, int num, block *extra) {
-    Hash hash;
-    for (int i = 0; i < num; ++i) {
-      hash.reset();
-      uint64_t idx = start + i;
-      hash.put(&idx, sizeof(idx));
-      hash.put(&in[i], sizeof(block));
-      hash.digest(out + i);
-    }
+  // out[i] = H(start + i || in[i] ^ delta), for the sender's second pad
+  void hash_blocks_with_delta(block *out, const block *in, int start, int num,
+                              const block *delta) {
+    blake3_crh16_batch(out, in, delta, start, num);
   }
 
   void send_pre(block *data, block in_Delta) {
@@ -72,47 +62,52 @@ public:
     // Hash input data -> pre_data[0..n)
     hash_blocks(pre_data, data, 0, n);
     // XOR with Delta and hash -> pre_data[n..2n)
-    xorBlocks_arr(pre_data + n, data, Delta, n);
-    hash_blocks(pre_data + n, pre_data + n, 0, n);
+    hash_blocks_with_delta(pre_data + n, data, 0, n, &Delta);
   }
 
   void recv_pre(block *data, bool *b) {
-    memcpy(bits, b, n);
+    pack_bits(bits, b, n);
     hash_blocks(pre_data, data, 0, n);
   }
 
   void recv_pre(block *data) {
+    memset(bits, 0, packed_bytes(n));
     for (int i = 0; i < n; ++i)
-      bits[i] = getLSB(data[i]);
+      xor_bit(bits, i, getLSB(data[i]));
     hash_blocks(pre_data, data, 0, n);
   }
 
-  void choices_sender() {
-    io->recv_data(bits + count, length);
-    count += length;
-  }
+  // One tree's choices; the bits of all trees go out in one packed message,
+  // send_choices() -> recv_choices()
+  void choices_sender() { count += length; }
 
   void choices_recver(const bool *b) {
-    for (int i = 0; i < length; ++i) {
-      bits[count + i] = (b[i] != bits[count + i]);
-    }
-    io->send_data(bits + count, length);
+    for (int i = 0; i < length; ++i)
+      xor_bit(bits, count + i, b[i]);
     count += length;
   }
 
+  void send_choices() { io->send_data(bits, (int)packed_bytes(count)); }
+
+  void recv_choices() { io->recv_data(bits, (int)packed_bytes(count)); }
+
   void reset() { count = 0; }
 
+  void keep_wire() { wire.resize(2 * (size_t)n); }
+
   void send(const block *m0, const block *m1, int length, IO *io2, int s) {
     block pad[2];
     int k = s * length;
     for (int i = 0; i < length; ++i) {
-      if (!bits[k]) {
+      if (!get_bit(bits, k)) {
         pad[0] = m0[i] ^ pre_data[k];
         pad[1] = m1[i] ^ pre_data[k + n];
       } else {
         pad[0] = m0[i] ^ pre_data[k + n];
         pad[1] = m1[i] ^ pre_data[k];
       }
+      if (!wire.empty())
+        memcpy(&wire[2 * (size_t)k], pad, sizeof(pad));
       ++k;
       io2->send_block(pad, 2);
     }
@@ -123,6 +118,8 @@ public:
     block pad[2];
     for (int i = 0; i < length; ++i) {
       io2->recv_block(pad, 2);
+      if (!wire.empty())
+        memcpy(&wire[2 * (size_t)k], pad, sizeof(pad));
       int ind = b[i] ? 1 : 0;
       data[i] = pre_data[k] ^ pad[ind];
       ++k;
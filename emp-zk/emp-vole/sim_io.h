@@ -0,0 +1,201 @@
+#ifndef EMP_SIM_IO_H__
+#define EMP_SIM_IO_H__
+
+// Network-condition simulator. SimIO<IO> wraps each party's transport and
+// keeps a virtual clock per party: local compute advances it by the
+// thread's CPU time, and a receive moves it forward to the simulated arrival
+// time of the bytes it consumes. Arrivals follow from the sender's clock,
+// one-way latency (RTT / 2 plus jitter), and a per-direction bandwidth cap
+// that serializes the bytes on the link. No real sleeping happens, so a
+// whole RTT/bandwidth sweep runs at compute speed.
+//
+// Both endpoints must share one SimLink, so the wrapped transport has to be
+// in-process (LocalIO).
+//
+// A party may hand its IO to a second thread for a while (the pipelined
+// prefetch of VoleTripleBlake3): fork() starts a side timeline at the
+// party's current time, enter() binds it to the calling thread, whose IO
+// and compute then advance it instead, and join() continues the party's
+// timeline at the later of the two, as waiting for the thread does. Only
+// one thread may use the IO at a time.
+
+#include "emp-zk/emp-vole/emp_tool_shim.h"
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <time.h>
+
+namespace emp {
+
+struct SimNetConfig {
+  double rtt_ms = 0;
+  double down_mbps = 0; // ALICE -> BOB; 0 = unlimited
+  double up_mbps = 0;   // BOB -> ALICE; 0 = unlimited
+  double jitter_ms = 0; // extra one-way delay, uniform in [0, jitter_ms]
+  uint64_t seed = 1;
+};
+
+class SimLink {
+public:
+  // Direction 0 is ALICE -> BOB, 1 is BOB -> ALICE
+  SimNetConfig cfg;
+
+  explicit SimLink(const SimNetConfig &cfg) : cfg(cfg) {
+    dirs[0].rng.seed(cfg.seed);
+    dirs[1].rng.seed(cfg.seed + 1);
+  }
+
+  // Records len bytes leaving at time depart_ms; returns their arrival
+  double send(int d, double depart_ms, size_t len) {
+    Dir &dir = dirs[d];
+    double mbps = d == 0 ? cfg.down_mbps : cfg.up_mbps;
+    std::lock_guard<std::mutex> lock(dir.m);
+    double start = std::max(depart_ms, dir.link_free);
+    dir.link_free = start + (mbps > 0 ? len * 8 / (mbps * 1e3) : 0);
+    double delay = cfg.rtt_ms / 2;
+    if (cfg.jitter_ms > 0)
+      delay += std::uniform_real_distribution<double>(0, cfg.jitter_ms)(dir.rng);
+    // In-order delivery, as over TCP
+    double arrival = std::max(dir.link_free + delay, dir.last_arrival);
+    dir.last_arrival = arrival;
+    dir.bytes += len;
+    dir.marks.push_back(std::make_pair(dir.bytes, arrival));
+    return arrival;
+  }
+
+  // Arrival time of byte offset end - 1 in direction d; bytes before end
+  // must not be asked for again
+  double arrival(int d, uint64_t end) {
+    Dir &dir = dirs[d];
+    std::lock_guard<std::mutex> lock(dir.m);
+    while (!dir.marks.empty() && dir.marks.front().first < end)
+      dir.marks.pop_front();
+    if (dir.marks.empty())
+      error("SimLink: bytes received before they were sent");
+    double t = dir.marks.front().second;
+    if (dir.marks.front().first == end)
+      dir.marks.pop_front();
+    return t;
+  }
+
+private:
+  struct Dir {
+    std::mutex m;
+    std::deque<std::pair<uint64_t, double>> marks; // (end offset, arrival)
+    uint64_t bytes = 0;
+    double link_free = 0;
+    double last_arrival = 0;
+    std::mt19937_64 rng;
+  };
+  Dir dirs[2];
+};
+
+template <typename IO> class SimIO {
+  IO *io;
+  SimLink *link;
+  int out_dir, in_dir;
+  // Virtual time and CPU time at the last IO call of one thread
+  struct Lane {
+    double clock_ms = 0;
+    double cpu_mark = 0;
+  };
+  Lane main_lane, side_lane;
+  bool side_active = false;
+  std::thread::id side_thread;
+  uint64_t consumed = 0;
+  int last_op = 0; // 1 = send, 2 = recv
+
+  static double thread_cpu_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+  }
+
+  // The calling thread's timeline
+  Lane &lane() {
+    if (side_active && std::this_thread::get_id() == side_thread)
+      return side_lane;
+    return main_lane;
+  }
+
+  // Local compute since the last IO call
+  void advance(Lane &l) { l.clock_ms += thread_cpu_ms() - l.cpu_mark; }
+
+public:
+  size_t bytes_sent = 0;
+  size_t bytes_recv = 0;
+  int64_t round_trips = 0; // send -> recv turns
+  double wait_ms = 0;      // virtual time spent waiting for the peer
+
+  SimIO(IO *io, SimLink *link, int party) : io(io), link(link) {
+    out_dir = party == ALICE ? 0 : 1;
+    in_dir = party == ALICE ? 1 : 0;
+    main_lane.cpu_mark = thread_cpu_ms();
+  }
+
+  // Virtual time of this party, including compute up to now
+  double now_ms() {
+    Lane &l = lane();
+    advance(l);
+    l.cpu_mark = thread_cpu_ms();
+    return l.clock_ms;
+  }
+
+  // Side timeline starting now, for the thread that calls enter()
+  void fork() { side_lane.clock_ms = now_ms(); }
+
+  void enter() {
+    side_thread = std::this_thread::get_id();
+    side_lane.cpu_mark = thread_cpu_ms();
+    side_active = true;
+  }
+
+  // Back on one timeline once the side thread has finished
+  void join() {
+    side_active = false;
+    double t = now_ms();
+    main_lane.clock_ms = std::max(t, side_lane.clock_ms);
+  }
+
+  void send_data(const void *data, int len) {
+    Lane &l = lane();
+    advance(l);
+    link->send(out_dir, l.clock_ms, len);
+    io->send_data(data, len);
+    bytes_sent += len;
+    last_op = 1;
+    l.cpu_mark = thread_cpu_ms();
+  }
+
+  void recv_data(void *data, int len) {
+    Lane &l = lane();
+    advance(l);
+    io->recv_data(data, len);
+    consumed += len;
+    double arrival = link->arrival(in_dir, consumed);
+    if (arrival > l.clock_ms) {
+      wait_ms += arrival - l.clock_ms;
+      l.clock_ms = arrival;
+    }
+    if (last_op == 1)
+      ++round_trips;
+    bytes_recv += len;
+    last_op = 2;
+    // Time blocked in the inner transport is not compute
+    l.cpu_mark = thread_cpu_ms();
+  }
+
+  void flush() { io->flush(); }
+
+  void print_stats() {
+    printf("Simulated: %.1f ms, %.1f ms waiting, %lld round trips, "
+           "sent=%zu recv=%zu bytes\n",
+           main_lane.clock_ms, wait_ms, (long long)round_trips, bytes_sent,
+           bytes_recv);
+  }
+};
+
+} // namespace emp
+
+#endif // EMP_SIM_IO_H__
@@ -5,42 +5,89 @@
 
 #include "emp-zk/emp-vole/utility.h"
 #include "emp-zk/emp-vole/twokeyprp_blake3.h"
+#include "emp-zk/emp-vole/fp61_kernels.h"
 // Note: emp-ot removed - not needed for BLAKE3 version
 #include <iostream>
 
 using namespace emp;
 
-template <typename IO> class SpfssRecverFpBlake3 {
+// Choice-bit seed counter shared by every tree depth
+template <typename IO> struct SpfssRecverCounterFpBlake3 {
+  static uint64_t instance_counter;
+};
+
+template <typename IO>
+uint64_t SpfssRecverCounterFpBlake3<IO>::instance_counter = 0;
+
+// Depth > 0 fixes the tree depth at compile time (see SpfssSenderFpBlake3);
+// pooled by MpfssRegFpBlake3 the same way, with reseed_choices() per run
+template <typename IO, int Depth = 0, typename Prp = TwoKeyPRP_Blake3>
+class SpfssRecverFpBlake3 : public SpfssRecverCounterFpBlake3<IO> {
 public:
+  using SpfssRecverCounterFpBlake3<IO>::instance_counter;
+
+  static constexpr int kLeaveN = Depth > 0 ? 1 << (Depth - 1) : 0;
+
   block *ggm_tree, *m;
   __uint128_t *ggm_tree_int;
   bool *b;
   int choice_pos, depth, leave_n;
   IO *io;
   uint64_t share;
+  bool own_mb = false;
+  block m_fixed[Depth > 0 ? Depth - 1 : 1];
+  bool b_fixed[Depth > 0 ? Depth - 1 : 1];
 
-  static uint64_t instance_counter;
+  SpfssRecverFpBlake3() {}
 
   SpfssRecverFpBlake3(IO *io, int depth_in) {
+    initialization(io, depth_in);
+    reseed_choices();
+  }
+
+  // m_mem/b_mem, if set, hold the depth - 1 OT messages and choice bits of a
+  // runtime depth
+  void initialization(IO *io, int depth_in, block *m_mem = nullptr,
+                      bool *b_mem = nullptr) {
     this->io = io;
-    this->depth = depth_in;
-    this->leave_n = 1 << (depth_in - 1);
-    m = new block[depth - 1];
-    b = new bool[depth - 1];
-    // Initialize choice bits from counter-seeded PRG (avoid slow hardware RNG)
+    if (Depth > 0 && depth_in != Depth)
+      error("SPFSS depth does not match the fixed parameter set");
+    this->depth = Depth > 0 ? Depth : depth_in;
+    this->leave_n = 1 << (this->depth - 1);
+    own_mb = Depth == 0 && m_mem == nullptr;
+    if (Depth > 0) {
+      m = m_fixed;
+      b = b_fixed;
+    } else if (own_mb) {
+      m = new block[depth - 1];
+      b = new bool[depth - 1];
+    } else {
+      m = m_mem;
+      b = b_mem;
+    }
+  }
+
+  // Fresh choice bits (the punctured leaf) from a counter-seeded PRG (avoid
+  // slow hardware RNG)
+  void reseed_choices() {
     block seed = makeBlock(0, ++instance_counter);
     PRG prg(&seed);
-    prg.random_bool(b, depth - 1);
+    prg.random_bool(b, levels());
   }
 
   ~SpfssRecverFpBlake3() {
-    delete[] m;
-    delete[] b;
+    if (own_mb) {
+      delete[] m;
+      delete[] b;
+    }
   }
 
+  int levels() const { return Depth > 0 ? Depth - 1 : depth - 1; }
+  int leaves() const { return Depth > 0 ? kLeaveN : leave_n; }
+
   int get_index() {
     choice_pos = 0;
-    for (int i = 0; i < depth - 1; ++i) {
+    for (int i = 0; i < levels(); ++i) {
       choice_pos <<= 1;
       if (!b[i])
         choice_pos += 1;
@@ -49,21 +96,19 @@ public:
   }
 
   template <typename OT> void recv(OT *ot, IO *io2, int s) {
-    ot->recv(m, b, depth - 1, io2, s);
+    ot->recv(m, b, levels(), io2, s);
     io2->recv_data(&share, sizeof(uint64_t));
   }
 
   void compute(__uint128_t *ggm_tree_mem, __uint128_t delta2) {
+    VOLE_PHASE(VOLE_PHASE_GGM_EXPAND);
+    VOLE_COUNT(VOLE_COUNT_GGM_TREES, 1);
     ggm_tree_int = ggm_tree_mem;
     this->ggm_tree = (block *)ggm_tree_mem;
     ggm_tree_reconstruction(b, m);
 
     ggm_tree[choice_pos] = zero_block;
-    uint64_t nodes_sum = (uint64_t)0;
-    for (int i = 0; i < leave_n; ++i) {
-      extract_fp(ggm_tree_mem[i]);
-      nodes_sum = add_mod(nodes_sum, (uint64_t)ggm_tree_mem[i]);
-    }
+    uint64_t nodes_sum = fp61_reduce_sum((uint64_t *)ggm_tree_mem, leaves());
     nodes_sum = add_mod(share, nodes_sum);
     nodes_sum = PR - nodes_sum;
     ggm_tree_mem[choice_pos] =
@@ -73,8 +118,10 @@ public:
   // Reconstruct GGM tree using BLAKE3-based PRG
   void ggm_tree_reconstruction(bool *b, block *m) {
     int to_fill_idx = 0;
-    TwoKeyPRP_Blake3 prp(zero_block, makeBlock(0, 1));
-    for (int i = 1; i < depth; ++i) {
+    Prp prp(zero_block, makeBlock(0, 1));
+    const int levels_n = levels();
+    VOLE_UNROLL
+    for (int i = 1; i <= levels_n; ++i) {
       to_fill_idx = to_fill_idx * 2;
       ggm_tree[to_fill_idx] = ggm_tree[to_fill_idx + 1] = zero_block;
       if (b[i - 1] == false) {
@@ -86,7 +133,7 @@ public:
   }
 
   void layer_recover(int depth, int lr, int to_fill_idx, block sum,
-                     TwoKeyPRP_Blake3 *prp) {
+                     Prp *prp) {
     int layer_start = 0;
     int item_n = 1 << depth;
     block nodes_sum = zero_block;
@@ -95,10 +142,9 @@ public:
     for (int i = lr_start; i < item_n; i += 2)
       nodes_sum = nodes_sum ^ ggm_tree[i];
     ggm_tree[to_fill_idx] = nodes_sum ^ sum;
-    if (depth == this->depth - 1)
+    if (depth == levels())
       return;
-    for (int i = item_n - 2; i >= 0; i -= 2)
-      prp->node_expand_2to4(&ggm_tree[i * 2], &ggm_tree[i]);
+    prp->expand_level(ggm_tree, item_n);
   }
 
   void consistency_check(IO *io2, __uint128_t z, __uint128_t beta) {
@@ -135,27 +181,36 @@ public:
     delete[] chi;
   }
 
-  void consistency_check_msg_gen(__uint128_t &chi_alpha, __uint128_t &W,
-                                 IO *io2, __uint128_t beta, block seed) {
-    __uint128_t *chi = new __uint128_t[leave_n];
-    Hash hash;
-    __uint128_t digest =
-        mod(_mm_extract_epi64(hash.hash_for_block(&seed, sizeof(block)), 0));
-    uni_hash_coeff_gen(chi, digest, leave_n);
-
-    chi_alpha = chi[choice_pos];
-
-    W = vector_inn_prdt_sum_red(chi, (__uint128_t *)ggm_tree, leave_n);
+  // chi_alpha[c] and W[c] for each of the checks challenges; chi holds
+  // their coefficient vectors, leaves() field elements each
+  // (MpfssRegFpBlake3::check_coeffs)
+  void consistency_check_msg_gen(__uint128_t *chi_alpha, __uint128_t *W,
+                                 __uint128_t beta, const __uint128_t *chi,
+                                 int checks) {
+    for (int c = 0; c < checks; ++c) {
+      const __uint128_t *chi_c = chi + (size_t)c * leaves();
+      chi_alpha[c] = chi_c[choice_pos];
+      W[c] = fp61_inner_product((const uint64_t *)chi_c,
+                                (const uint64_t *)ggm_tree, leaves());
+    }
 
     uint64_t tmp2 = _mm_extract_epi64((block)beta, 1);
     ggm_tree_int[choice_pos] =
         ((__uint128_t)tmp2 << 64) ^ ggm_tree_int[choice_pos];
+  }
 
-    delete[] chi;
+  // The same over the z words of the leaves packed as 64-bit words (split
+  // receiver storage), with chi as leaves() words per challenge; the caller
+  // places beta's x word
+  void consistency_check_msg_gen(__uint128_t *chi_alpha, __uint128_t *W,
+                                 const uint64_t *chi, int checks,
+                                 const uint64_t *leaves64) {
+    for (int c = 0; c < checks; ++c) {
+      const uint64_t *chi_c = chi + (size_t)c * leaves();
+      chi_alpha[c] = chi_c[choice_pos];
+      W[c] = fp61_inner_product_u64(chi_c, leaves64, leaves());
+    }
   }
 };
 
-template <typename IO>
-uint64_t SpfssRecverFpBlake3<IO>::instance_counter = 0;
-
 #endif // SPFSS_RECVER_FP_BLAKE3_H__
@@ -5,13 +5,23 @@
 
 #include "emp-zk/emp-vole/utility.h"
 #include "emp-zk/emp-vole/twokeyprp_blake3.h"
+#include "emp-zk/emp-vole/fp61_kernels.h"
 // Note: emp-ot removed - not needed for BLAKE3 version
 #include <iostream>
 
 using namespace emp;
 
-template <typename IO> class SpfssSenderFpBlake3 {
+// Depth > 0 fixes the tree depth at compile time: OT messages live in the
+// object and the level loop is unrolled. Depth == 0 reads it at runtime.
+// MpfssRegFpBlake3 keeps one array of senders with their OT messages in its
+// arena and reseeds them each run (default constructor + initialization).
+// Prp expands the tree: TwoKeyPRP_Blake3, or HalfTreePRP_Blake3 for one hash
+// per node; the receiver must use the same.
+template <typename IO, int Depth = 0, typename Prp = TwoKeyPRP_Blake3>
+class SpfssSenderFpBlake3 {
 public:
+  static constexpr int kLeaveN = Depth > 0 ? 1 << (Depth - 1) : 0;
+
   block seed;
   block *ggm_tree, *m;
   __uint128_t delta;
@@ -19,30 +29,46 @@ public:
   IO *io;
   int depth;
   int leave_n;
-  PRG prg;
+  bool own_m = false;
+  block m_fixed[Depth > 0 ? 2 * (Depth - 1) : 1];
+
+  SpfssSenderFpBlake3() {}
 
   SpfssSenderFpBlake3(IO *io, int depth_in) {
     initialization(io, depth_in);
+    PRG prg;
     prg.random_block(&seed, 1);
   }
 
-  void initialization(IO *io, int depth_in) {
+  // m_mem, if set, holds the 2 * (depth - 1) OT messages of a runtime depth
+  void initialization(IO *io, int depth_in, block *m_mem = nullptr) {
     this->io = io;
-    this->depth = depth_in;
+    if (Depth > 0 && depth_in != Depth)
+      error("SPFSS depth does not match the fixed parameter set");
+    this->depth = Depth > 0 ? Depth : depth_in;
     this->leave_n = 1 << (this->depth - 1);
-    m = new block[(depth - 1) * 2];
+    own_m = Depth == 0 && m_mem == nullptr;
+    m = Depth > 0 ? m_fixed : own_m ? new block[(depth - 1) * 2] : m_mem;
+  }
+
+  ~SpfssSenderFpBlake3() {
+    if (own_m)
+      delete[] m;
   }
 
-  ~SpfssSenderFpBlake3() { delete[] m; }
+  int levels() const { return Depth > 0 ? Depth - 1 : depth - 1; }
+  int leaves() const { return Depth > 0 ? kLeaveN : leave_n; }
 
   void compute(__uint128_t *ggm_tree_mem, __uint128_t secret,
                __uint128_t gamma) {
+    VOLE_PHASE(VOLE_PHASE_GGM_EXPAND);
+    VOLE_COUNT(VOLE_COUNT_GGM_TREES, 1);
     this->delta = secret;
-    ggm_tree_gen(m, m + depth - 1, ggm_tree_mem, secret, gamma);
+    ggm_tree_gen(m, m + levels(), ggm_tree_mem, secret, gamma);
   }
 
   template <typename OT> void send(OT *ot, IO *io2, int s) {
-    ot->send(m, &m[depth - 1], depth - 1, io2, s);
+    ot->send(m, &m[levels()], levels(), io2, s);
     io2->send_data(&secret_sum, sizeof(uint64_t));
     io2->flush();
   }
@@ -51,27 +77,22 @@ public:
   void ggm_tree_gen(block *ot_msg_0, block *ot_msg_1, __uint128_t *ggm_tree_mem,
                     __uint128_t secret, __uint128_t gamma) {
     this->ggm_tree = (block *)ggm_tree_mem;
-    TwoKeyPRP_Blake3 *prp = new TwoKeyPRP_Blake3(zero_block, makeBlock(0, 1));
-    prp->node_expand_1to2(ggm_tree, seed);
+    Prp prp(zero_block, makeBlock(0, 1));
+    prp.node_expand_1to2(ggm_tree, seed);
     ot_msg_0[0] = ggm_tree[0];
     ot_msg_1[0] = ggm_tree[1];
-    for (int h = 1; h < depth - 1; ++h) {
+    const int levels_n = levels();
+    VOLE_UNROLL
+    for (int h = 1; h < levels_n; ++h) {
       ot_msg_0[h] = ot_msg_1[h] = zero_block;
       int sz = 1 << h;
-      for (int i = sz - 2; i >= 0; i -= 2) {
-        prp->node_expand_2to4(&ggm_tree[i * 2], &ggm_tree[i]);
-        ot_msg_0[h] = ot_msg_0[h] ^ ggm_tree[i * 2];
-        ot_msg_0[h] = ot_msg_0[h] ^ ggm_tree[i * 2 + 2];
-        ot_msg_1[h] = ot_msg_1[h] ^ ggm_tree[i * 2 + 1];
-        ot_msg_1[h] = ot_msg_1[h] ^ ggm_tree[i * 2 + 3];
+      prp.expand_level(ggm_tree, sz);
+      for (int i = 0; i < 2 * sz; i += 2) {
+        ot_msg_0[h] = ot_msg_0[h] ^ ggm_tree[i];
+        ot_msg_1[h] = ot_msg_1[h] ^ ggm_tree[i + 1];
       }
     }
-    delete prp;
-    secret_sum = (uint64_t)0;
-    for (int i = 0; i < leave_n; ++i) {
-      extract_fp(ggm_tree_mem[i]);
-      secret_sum = add_mod(secret_sum, (uint64_t)ggm_tree_mem[i]);
-    }
+    secret_sum = fp61_reduce_sum((uint64_t *)ggm_tree_mem, leaves());
     secret_sum = PR - secret_sum;
     secret_sum = add_mod((uint64_t)gamma, secret_sum);
   }
@@ -101,16 +122,22 @@ public:
     delete[] chi;
   }
 
-  void consistency_check_msg_gen(__uint128_t &V, IO *io2, block seed) {
-    __uint128_t *chi = new __uint128_t[leave_n];
-    Hash hash;
-    __uint128_t digest =
-        mod(_mm_extract_epi64(hash.hash_for_block(&seed, sizeof(block)), 0));
-    uni_hash_coeff_gen(chi, digest, leave_n);
-
-    V = vector_inn_prdt_sum_red(chi, (__uint128_t *)ggm_tree, leave_n);
+  // V[c] for each of the checks challenges; chi holds their coefficient
+  // vectors, leaves() field elements each (MpfssRegFpBlake3::check_coeffs)
+  void consistency_check_msg_gen(__uint128_t *V, const __uint128_t *chi,
+                                 int checks) {
+    for (int c = 0; c < checks; ++c)
+      V[c] = fp61_inner_product((const uint64_t *)(chi + (size_t)c * leaves()),
+                                (const uint64_t *)ggm_tree, leaves());
+  }
 
-    delete[] chi;
+  // The same over leaves packed as 64-bit words (compact sender storage),
+  // with chi as leaves() words per challenge
+  void consistency_check_msg_gen(__uint128_t *V, const uint64_t *chi,
+                                 int checks, const uint64_t *leaves64) {
+    for (int c = 0; c < checks; ++c)
+      V[c] = fp61_inner_product_u64(chi + (size_t)c * leaves(), leaves64,
+                                    leaves());
   }
 };
 
@@ -0,0 +1,187 @@
+#ifndef EMP_TRANSCRIPT_IO_H__
+#define EMP_TRANSCRIPT_IO_H__
+
+// Receiver-side transcript capture and replay.
+//
+// RecordIO<IO> wraps the receiver's live transport and logs every byte in
+// both directions. ReplayIO then stands in for the sender: recv_data returns
+// the recorded sender bytes, and send_data checks that the receiver sends
+// what it sent during recording. Replaying a receiver needs deterministic
+// receiver randomness (VoleTripleBlake3::set_seed with
+// VOLE_TRANSCRIPT_SEED); the mock base COTs/VOLEs are deterministic already.
+//
+// File layout: "VOLETRC1", profile name (32 bytes, NUL padded), then
+// records of [direction u8][length u32 LE][bytes]. Consecutive transfers in
+// one direction are merged into one record.
+
+#include "emp-zk/emp-vole/emp_tool_shim.h"
+#include <string>
+
+namespace emp {
+
+const static char VOLE_TRANSCRIPT_MAGIC[8] = {'V', 'O', 'L', 'E',
+                                              'T', 'R', 'C', '1'};
+const static int VOLE_TRANSCRIPT_PROFILE_LEN = 32;
+const static uint8_t VOLE_TRANSCRIPT_SENT = 0; // receiver -> sender
+const static uint8_t VOLE_TRANSCRIPT_RECV = 1; // sender -> receiver
+
+// Receiver seed used for recording and replay
+const static block VOLE_TRANSCRIPT_SEED =
+    makeBlock(0x7265706C61790000ULL, 0x0000766F6C657472ULL);
+
+template <typename IO> class RecordIO {
+  IO *io;
+  std::string path;
+  std::vector<uint8_t> log;
+  size_t last_header = 0;
+  int last_dir = -1;
+
+  void append(uint8_t dir, const void *data, int len) {
+    if (last_dir != dir) {
+      last_header = log.size();
+      last_dir = dir;
+      log.push_back(dir);
+      log.resize(log.size() + sizeof(uint32_t), 0);
+    }
+    log.insert(log.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+    uint32_t rec_len;
+    memcpy(&rec_len, log.data() + last_header + 1, sizeof(uint32_t));
+    rec_len += len;
+    memcpy(log.data() + last_header + 1, &rec_len, sizeof(uint32_t));
+  }
+
+public:
+  size_t bytes_sent = 0;
+  size_t bytes_recv = 0;
+
+  RecordIO(IO *io, const char *path, const char *profile)
+      : io(io), path(path) {
+    uint8_t header[8 + VOLE_TRANSCRIPT_PROFILE_LEN] = {0};
+    memcpy(header, VOLE_TRANSCRIPT_MAGIC, 8);
+    strncpy((char *)header + 8, profile, VOLE_TRANSCRIPT_PROFILE_LEN - 1);
+    log.assign(header, header + sizeof(header));
+  }
+
+  ~RecordIO() { save(); }
+
+  void send_data(const void *data, int len) {
+    io->send_data(data, len);
+    append(VOLE_TRANSCRIPT_SENT, data, len);
+    bytes_sent += len;
+  }
+
+  void recv_data(void *data, int len) {
+    io->recv_data(data, len);
+    append(VOLE_TRANSCRIPT_RECV, data, len);
+    bytes_recv += len;
+  }
+
+  void flush() { io->flush(); }
+
+  // Writes the transcript so far; called again by the destructor
+  void save() {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (f == nullptr)
+      error("Cannot open transcript file for writing");
+    if (fwrite(log.data(), 1, log.size(), f) != log.size())
+      error("Short write to transcript file");
+    fclose(f);
+  }
+
+  void print_stats() {
+    io->print_stats();
+    printf("Transcript: %zu bytes -> %s\n", log.size(), path.c_str());
+  }
+};
+
+class ReplayIO {
+  std::vector<uint8_t> log;
+  size_t pos = 0;       // next unread byte of log
+  int cur_dir = -1;     // direction of the current record
+  size_t cur_left = 0;  // bytes left in the current record
+
+  void init() {
+    if (log.size() < 8 + VOLE_TRANSCRIPT_PROFILE_LEN ||
+        memcmp(log.data(), VOLE_TRANSCRIPT_MAGIC, 8) != 0)
+      error("Not a VOLE transcript");
+    pos = 8 + VOLE_TRANSCRIPT_PROFILE_LEN;
+  }
+
+  // Next len bytes of direction dir, spanning merged records
+  const uint8_t *take(uint8_t dir, size_t len) {
+    if (cur_left == 0) {
+      if (pos + 1 + sizeof(uint32_t) > log.size())
+        error("Replay transcript exhausted");
+      cur_dir = log[pos];
+      uint32_t rec_len;
+      memcpy(&rec_len, log.data() + pos + 1, sizeof(uint32_t));
+      cur_left = rec_len;
+      pos += 1 + sizeof(uint32_t);
+    }
+    if (cur_dir != dir || cur_left < len || pos + len > log.size())
+      error("Replay diverged from the recorded transcript");
+    const uint8_t *p = log.data() + pos;
+    pos += len;
+    cur_left -= len;
+    return p;
+  }
+
+public:
+  size_t bytes_sent = 0;
+  size_t bytes_recv = 0;
+
+  explicit ReplayIO(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr)
+      error("Cannot open transcript file");
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    log.resize(sz > 0 ? sz : 0);
+    if (fread(log.data(), 1, log.size(), f) != log.size())
+      error("Short read from transcript file");
+    fclose(f);
+    init();
+  }
+
+  // Transcript already in memory (e.g. handed over from JavaScript)
+  ReplayIO(const uint8_t *data, size_t len) : log(data, data + len) { init(); }
+
+  // Profile name stored in the transcript header
+  std::string profile() const {
+    return std::string((const char *)log.data() + 8,
+                       strnlen((const char *)log.data() + 8,
+                               VOLE_TRANSCRIPT_PROFILE_LEN));
+  }
+
+  // Rewind for another replay of the same transcript
+  void rewind() {
+    init();
+    cur_dir = -1;
+    cur_left = 0;
+    bytes_sent = bytes_recv = 0;
+  }
+
+  bool finished() const { return cur_left == 0 && pos == log.size(); }
+
+  void send_data(const void *data, int len) {
+    if (memcmp(take(VOLE_TRANSCRIPT_SENT, len), data, len) != 0)
+      error("Replay diverged: receiver sent different bytes");
+    bytes_sent += len;
+  }
+
+  void recv_data(void *data, int len) {
+    memcpy(data, take(VOLE_TRANSCRIPT_RECV, len), len);
+    bytes_recv += len;
+  }
+
+  void flush() {}
+
+  void print_stats() {
+    printf("Replay: sent=%zu bytes, recv=%zu bytes\n", bytes_sent, bytes_recv);
+  }
+};
+
+} // namespace emp
+
+#endif // EMP_TRANSCRIPT_IO_H__
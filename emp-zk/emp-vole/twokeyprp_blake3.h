@@ -1,95 +1,130 @@
 #ifndef EMP_TWOKEYPRP_BLAKE3_H__
 #define EMP_TWOKEYPRP_BLAKE3_H__
 
-#include "emp-zk/emp-vole/blake3.h"
+#include "emp-zk/emp-vole/blake3_batch.h"
 #include <cstring>
 
 namespace emp {
 
 // BLAKE3-based GGM tree node expansion
 // Drop-in replacement for TwoKeyPRP (AES-based)
-// Uses counter-based construction: child = H(counter || parent) XOR parent
+// Uses counter-based construction: child = H(counter || parent) XOR parent,
+// where H is BLAKE3 over the 64-byte zero-padded message, truncated to 16
+// bytes. Padding to a full block lets whole tree levels go through
+// blake3_hash_many.
 
 class TwoKeyPRP_Blake3 {
 public:
+  // Parents expanded per blake3_hash_many call (2 messages each)
+  static const int kBatch = 64;
+
   // Constructor takes two blocks but we use simple counter-based expansion
   // seed0/seed1 are ignored - we use fixed counters 0 and 1
   TwoKeyPRP_Blake3(block s0, block s1) {
     (void)s0; (void)s1;  // Unused - we use counter-based construction
   }
 
-  // Expand 1 parent node to 2 children using counter-based PRG
-  // child[0] = H(0 || parent) XOR parent
-  // child[1] = H(1 || parent) XOR parent
+  // children[2i + c] = H(c || parents[i]) XOR parents[i] for i < n, n <= kBatch.
+  // children may alias parents.
+  void expand(block *children, const block *parents, int n) {
+    uint8_t msg[2 * kBatch][BLAKE3_BATCH_MSG_LEN];
+    const uint8_t *msgs[2 * kBatch];
+    uint8_t out[2 * kBatch * 32];
+    block par[kBatch];
+    memcpy(par, parents, n * sizeof(block));
+    for (int i = 0; i < n; ++i) {
+      for (int c = 0; c < 2; ++c) {
+        uint8_t *m = msg[2 * i + c];
+        memset(m, 0, BLAKE3_BATCH_MSG_LEN);
+        m[0] = (uint8_t)c;
+        memcpy(m + 1, &par[i], 16);
+        msgs[2 * i + c] = m;
+      }
+    }
+    blake3_hash64_batch(msgs, 2 * n, out);
+    for (int i = 0; i < 2 * n; ++i) {
+      block h;
+      memcpy(&h, out + 32 * i, 16);
+      children[i] = h ^ par[i / 2];
+    }
+  }
+
+  // Expand one tree level in place: tree[0..n) are the parents, tree[0..2n)
+  // the children. Runs from the top so no parent is overwritten before use.
+  void expand_level(block *tree, int n) {
+    int end = n;
+    while (end > 0) {
+      int start = end > kBatch ? end - kBatch : 0;
+      expand(&tree[2 * start], &tree[start], end - start);
+      end = start;
+    }
+  }
+
+  // Expand 1 parent node to 2 children
   void node_expand_1to2(block *children, block parent) {
-    uint8_t input[17];  // 1 byte counter + 16 byte parent
-    uint8_t output[32];
-    uint8_t parent_bytes[16];
-    memcpy(parent_bytes, &parent, 16);
-    blake3_hasher hasher;
-
-    // Left child: H(0 || parent) XOR parent
-    input[0] = 0;
-    memcpy(input + 1, parent_bytes, 16);
-    blake3_hasher_init(&hasher);
-    blake3_hasher_update(&hasher, input, 17);
-    blake3_hasher_finalize(&hasher, output, 32);
-    for (int i = 0; i < 16; i++) output[i] ^= parent_bytes[i];
-    memcpy(&children[0], output, 16);
-
-    // Right child: H(1 || parent) XOR parent
-    input[0] = 1;
-    blake3_hasher_init(&hasher);
-    blake3_hasher_update(&hasher, input, 17);
-    blake3_hasher_finalize(&hasher, output, 32);
-    for (int i = 0; i < 16; i++) output[i] ^= parent_bytes[i];
-    memcpy(&children[1], output, 16);
+    expand(children, &parent, 1);
   }
 
   // Expand 2 parent nodes to 4 children
   void node_expand_2to4(block *children, block *parent) {
-    uint8_t input[17];
-    uint8_t output[32];
-    uint8_t parent0_bytes[16], parent1_bytes[16];
-    memcpy(parent0_bytes, &parent[0], 16);
-    memcpy(parent1_bytes, &parent[1], 16);
-    blake3_hasher hasher;
-
-    // children[0] = H(0 || parent[0]) XOR parent[0]
-    input[0] = 0;
-    memcpy(input + 1, parent0_bytes, 16);
-    blake3_hasher_init(&hasher);
-    blake3_hasher_update(&hasher, input, 17);
-    blake3_hasher_finalize(&hasher, output, 32);
-    for (int i = 0; i < 16; i++) output[i] ^= parent0_bytes[i];
-    memcpy(&children[0], output, 16);
-
-    // children[1] = H(1 || parent[0]) XOR parent[0]
-    input[0] = 1;
-    memcpy(input + 1, parent0_bytes, 16);
-    blake3_hasher_init(&hasher);
-    blake3_hasher_update(&hasher, input, 17);
-    blake3_hasher_finalize(&hasher, output, 32);
-    for (int i = 0; i < 16; i++) output[i] ^= parent0_bytes[i];
-    memcpy(&children[1], output, 16);
-
-    // children[2] = H(0 || parent[1]) XOR parent[1]
-    input[0] = 0;
-    memcpy(input + 1, parent1_bytes, 16);
-    blake3_hasher_init(&hasher);
-    blake3_hasher_update(&hasher, input, 17);
-    blake3_hasher_finalize(&hasher, output, 32);
-    for (int i = 0; i < 16; i++) output[i] ^= parent1_bytes[i];
-    memcpy(&children[2], output, 16);
-
-    // children[3] = H(1 || parent[1]) XOR parent[1]
-    input[0] = 1;
-    memcpy(input + 1, parent1_bytes, 16);
-    blake3_hasher_init(&hasher);
-    blake3_hasher_update(&hasher, input, 17);
-    blake3_hasher_finalize(&hasher, output, 32);
-    for (int i = 0; i < 16; i++) output[i] ^= parent1_bytes[i];
-    memcpy(&children[3], output, 16);
+    expand(children, parent, 2);
+  }
+};
+
+// Half-tree GGM expansion (Guo et al., Eurocrypt 2023): one hash per node,
+// left = H(parent), right = parent XOR left, where H is BLAKE3 over the
+// 64-byte zero-padded message (tag 2 || parent), truncated to 16 bytes.
+// Same interface and OT message format as TwoKeyPRP_Blake3 (the XOR of each
+// level's left and right children); half the hash calls per tree.
+class HalfTreePRP_Blake3 {
+public:
+  // Parents expanded per blake3_hash_many call (1 message each)
+  static const int kBatch = 128;
+
+  HalfTreePRP_Blake3(block s0, block s1) {
+    (void)s0; (void)s1;
+  }
+
+  // children[2i] = H(parents[i]), children[2i + 1] = parents[i] XOR
+  // children[2i] for i < n, n <= kBatch. children may alias parents.
+  void expand(block *children, const block *parents, int n) {
+    uint8_t msg[kBatch][BLAKE3_BATCH_MSG_LEN];
+    const uint8_t *msgs[kBatch];
+    uint8_t out[kBatch * 32];
+    block par[kBatch];
+    memcpy(par, parents, n * sizeof(block));
+    for (int i = 0; i < n; ++i) {
+      uint8_t *m = msg[i];
+      memset(m, 0, BLAKE3_BATCH_MSG_LEN);
+      m[0] = 2;
+      memcpy(m + 1, &par[i], 16);
+      msgs[i] = m;
+    }
+    blake3_hash64_batch(msgs, n, out);
+    for (int i = 0; i < n; ++i) {
+      block h;
+      memcpy(&h, out + 32 * i, 16);
+      children[2 * i] = h;
+      children[2 * i + 1] = h ^ par[i];
+    }
+  }
+
+  // Expand one tree level in place (see TwoKeyPRP_Blake3::expand_level)
+  void expand_level(block *tree, int n) {
+    int end = n;
+    while (end > 0) {
+      int start = end > kBatch ? end - kBatch : 0;
+      expand(&tree[2 * start], &tree[start], end - start);
+      end = start;
+    }
+  }
+
+  void node_expand_1to2(block *children, block parent) {
+    expand(children, &parent, 1);
+  }
+
+  void node_expand_2to4(block *children, block *parent) {
+    expand(children, parent, 2);
   }
 };
 
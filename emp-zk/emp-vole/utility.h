@@ -240,4 +240,13 @@ T vector_inn_prdt_sum_red(const S *a, const T *b, int sz) {
 
 #endif // EMP_PORTABLE
 
+// Unroll hint for loops whose trip count is a template constant
+#if defined(__clang__)
+#define VOLE_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define VOLE_UNROLL _Pragma("GCC unroll 16")
+#else
+#define VOLE_UNROLL
+#endif
+
 #endif // FP_UTILITY_H__
@@ -0,0 +1,321 @@
+#ifndef EMP_VOLE_ALLOC_H__
+#define EMP_VOLE_ALLOC_H__
+
+// Allocator layer for the large VOLE buffers (pre-VOLEs, round outputs, OT
+// pads, dual-LPN noise). vole_alloc() returns memory aligned to kVoleAlign
+// (a cache line, and one AVX-512 vector) from the current VoleAllocator,
+// and vole_free() gives it back without the caller keeping its size.
+//
+// The default VoleArena maps buffers of kVoleHugeMin bytes and up with huge
+// pages on Linux, starting on a huge-page boundary. VOLE_HUGEPAGES picks the
+// backing: "thp" (the default: anonymous mappings with
+// madvise(MADV_HUGEPAGE)), "explicit" (MAP_HUGETLB from the reserved pool,
+// falling back to thp) or "off" (the heap, like new[]). Freed mappings are
+// unmapped, unless VOLE_ARENA_CACHE_MB opts into keeping up to that many MB
+// of them resident (until trim()) to serve later buffers of the same shape.
+// vole_set_allocator() plugs in another allocator.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#define VOLE_ALLOC_MMAP
+#endif
+
+namespace emp {
+
+// Alignment of every vole_alloc() pointer
+const size_t kVoleAlign = 64;
+// Buffers from this size up are page-mapped and cached by VoleArena, in
+// multiples of kVoleHugePage
+const size_t kVoleHugeMin = (size_t)1 << 20;
+const size_t kVoleHugePage = (size_t)1 << 21;
+
+enum VoleHugePages { VOLE_HUGE_OFF, VOLE_HUGE_THP, VOLE_HUGE_EXPLICIT };
+
+inline VoleHugePages vole_huge_pages_env() {
+  const char *env = getenv("VOLE_HUGEPAGES");
+  if (env != nullptr && strcmp(env, "off") == 0)
+    return VOLE_HUGE_OFF;
+  if (env != nullptr && strcmp(env, "explicit") == 0)
+    return VOLE_HUGE_EXPLICIT;
+  return VOLE_HUGE_THP;
+}
+
+inline const char *vole_huge_pages_name(VoleHugePages mode) {
+  switch (mode) {
+  case VOLE_HUGE_OFF:
+    return "off";
+  case VOLE_HUGE_EXPLICIT:
+    return "explicit";
+  default:
+    return "thp";
+  }
+}
+
+inline void *vole_heap_alloc(size_t bytes) {
+  void *p = nullptr;
+  if (posix_memalign(&p, kVoleAlign, bytes > 0 ? bytes : 1) != 0) {
+    fprintf(stderr, "Error: out of memory\n");
+    abort();
+  }
+  return p;
+}
+
+class VoleAllocator {
+public:
+  virtual ~VoleAllocator() {}
+  // At least bytes, aligned to kVoleAlign. bytes may be rounded up to what
+  // was reserved; deallocate() gets that value back.
+  virtual void *allocate(size_t &bytes) = 0;
+  virtual void deallocate(void *p, size_t bytes) = 0;
+};
+
+// Counters of a VoleArena's mapped buffers
+struct VoleArenaStats {
+  int64_t maps = 0;         // fresh mappings
+  int64_t huge_maps = 0;    // of which MAP_HUGETLB
+  int64_t reuses = 0;       // buffers served from the cache
+  int64_t mapped_bytes = 0; // mapped now, cached ones included
+};
+
+class VoleArena : public VoleAllocator {
+public:
+  VoleHugePages mode;
+  // Freed mappings are kept for reuse up to this many bytes in total
+  size_t cache_limit = 0;
+
+  explicit VoleArena(VoleHugePages mode = vole_huge_pages_env())
+      : mode(mode) {
+    const char *env = getenv("VOLE_ARENA_CACHE_MB");
+    if (env != nullptr)
+      cache_limit = (size_t)atoll(env) << 20;
+  }
+
+  ~VoleArena() { trim(); }
+
+  void *allocate(size_t &bytes) override {
+    if (mode == VOLE_HUGE_OFF || bytes < kVoleHugeMin)
+      return vole_heap_alloc(bytes);
+    bytes = (bytes + kVoleHugePage - 1) & ~(kVoleHugePage - 1);
+    std::lock_guard<std::mutex> lock(mu);
+    // Smallest cached mapping that fits without wasting more than half
+    int best = -1;
+    for (size_t i = 0; i < cache.size(); ++i)
+      if (cache[i].bytes >= bytes && cache[i].bytes <= 2 * bytes &&
+          (best < 0 || cache[i].bytes < cache[best].bytes))
+        best = (int)i;
+    if (best >= 0) {
+      void *p = cache[best].p;
+      bytes = cache[best].bytes;
+      cached_bytes -= bytes;
+      cache.erase(cache.begin() + best);
+      ++st.reuses;
+      return p;
+    }
+    return map(bytes);
+  }
+
+  void deallocate(void *p, size_t bytes) override {
+    if (mode == VOLE_HUGE_OFF || bytes < kVoleHugeMin) {
+      free(p);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mu);
+    if (cached_bytes + bytes <= cache_limit) {
+      cache.push_back({p, bytes});
+      cached_bytes += bytes;
+      return;
+    }
+    unmap(p, bytes);
+  }
+
+  // Releases every cached mapping
+  void trim() {
+    std::lock_guard<std::mutex> lock(mu);
+    for (auto &c : cache)
+      unmap(c.p, c.bytes);
+    cache.clear();
+    cached_bytes = 0;
+  }
+
+  VoleArenaStats stats() {
+    std::lock_guard<std::mutex> lock(mu);
+    return st;
+  }
+
+private:
+  struct Cached {
+    void *p;
+    size_t bytes;
+  };
+  std::mutex mu;
+  std::vector<Cached> cache;
+  size_t cached_bytes = 0;
+  VoleArenaStats st;
+
+  void *map(size_t bytes) {
+    ++st.maps;
+    st.mapped_bytes += bytes;
+#ifdef VOLE_ALLOC_MMAP
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (mode == VOLE_HUGE_EXPLICIT) {
+      p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED)
+        ++st.huge_maps;
+    }
+#endif
+    if (p == MAP_FAILED) {
+      // One huge page of slack, trimmed so the buffer starts on a boundary
+      // and every one of its 2 MB pages can be backed by a huge page
+      char *q = (char *)mmap(nullptr, bytes + kVoleHugePage,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (q == (char *)MAP_FAILED) {
+        fprintf(stderr, "Error: out of memory\n");
+        abort();
+      }
+      size_t head = (kVoleHugePage - (uintptr_t)q % kVoleHugePage) %
+                    kVoleHugePage;
+      if (head > 0)
+        munmap(q, head);
+      if (head < kVoleHugePage)
+        munmap(q + head + bytes, kVoleHugePage - head);
+      p = q + head;
+#ifdef MADV_HUGEPAGE
+      madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    }
+    return p;
+#else
+    return vole_heap_alloc(bytes);
+#endif
+  }
+
+  void unmap(void *p, size_t bytes) {
+    st.mapped_bytes -= bytes;
+#ifdef VOLE_ALLOC_MMAP
+    munmap(p, bytes);
+#else
+    free(p);
+#endif
+  }
+};
+
+// The process-wide default arena; never destroyed, so buffers may outlive
+// static destructors
+inline VoleArena &vole_arena() {
+  static VoleArena *arena = new VoleArena();
+  return *arena;
+}
+
+inline VoleAllocator *&vole_allocator_slot() {
+  static VoleAllocator *cur = nullptr;
+  return cur;
+}
+
+inline VoleAllocator *vole_allocator() {
+  VoleAllocator *a = vole_allocator_slot();
+  return a != nullptr ? a : &vole_arena();
+}
+
+// Routes later vole_alloc() calls to a (nullptr: the default arena). Each
+// buffer remembers its allocator, so earlier ones are still freed by theirs.
+inline void vole_set_allocator(VoleAllocator *a) { vole_allocator_slot() = a; }
+
+// Owner and reserved size of a live buffer. They are kept out of band, so
+// a buffer is exactly what its allocator handed out: a 2 MB multiple stays
+// one, and a mapped buffer starts on its huge-page boundary.
+struct VoleAllocHeader {
+  VoleAllocator *owner;
+  size_t bytes;
+};
+
+// Headers of the live buffers by address
+struct VoleAllocTable {
+  std::mutex mu;
+  std::unordered_map<void *, VoleAllocHeader> live;
+};
+
+// Never destroyed, like the default arena
+inline VoleAllocTable &vole_alloc_table() {
+  static VoleAllocTable *table = new VoleAllocTable();
+  return *table;
+}
+
+inline void *vole_alloc(size_t bytes) {
+  VoleAllocator *a = vole_allocator();
+  size_t total = bytes;
+  void *p = a->allocate(total);
+  VoleAllocTable &t = vole_alloc_table();
+  std::lock_guard<std::mutex> lock(t.mu);
+  t.live[p] = {a, total};
+  return p;
+}
+
+inline void vole_free(void *p) {
+  if (p == nullptr)
+    return;
+  VoleAllocTable &t = vole_alloc_table();
+  VoleAllocHeader h;
+  {
+    std::lock_guard<std::mutex> lock(t.mu);
+    auto it = t.live.find(p);
+    if (it == t.live.end()) {
+      fprintf(stderr, "Error: vole_free of an unknown buffer\n");
+      abort();
+    }
+    h = it->second;
+    t.live.erase(it);
+  }
+  h.owner->deallocate(p, h.bytes);
+}
+
+// n uninitialised elements of a trivial type T, as new T[n]
+template <typename T> T *vole_alloc_array(int64_t n) {
+  return (T *)vole_alloc((size_t)n * sizeof(T));
+}
+
+// Owning vole_alloc_array() buffer for callers' output arrays
+template <typename T> class VoleBuffer {
+  T *p = nullptr;
+  int64_t n = 0;
+
+public:
+  VoleBuffer() {}
+  explicit VoleBuffer(int64_t n) { resize(n); }
+  VoleBuffer(const VoleBuffer &) = delete;
+  VoleBuffer &operator=(const VoleBuffer &) = delete;
+  ~VoleBuffer() { vole_free(p); }
+
+  // Drops the contents
+  void resize(int64_t size) {
+    vole_free(p);
+    p = size > 0 ? vole_alloc_array<T>(size) : nullptr;
+    n = size;
+  }
+
+  T *data() { return p; }
+  int64_t size() const { return n; }
+
+  // Hands the buffer over, to be freed with vole_free()
+  T *release() {
+    T *q = p;
+    p = nullptr;
+    n = 0;
+    return q;
+  }
+};
+
+} // namespace emp
+
+#endif // EMP_VOLE_ALLOC_H__
@@ -0,0 +1,97 @@
+#ifndef VOLE_CHUNK_POOL_H__
+#define VOLE_CHUNK_POOL_H__
+
+// Lease/release pool of receiver VOLE chunks in split (x, z) layout.
+// Each chunk is one allocation holding z[0..capacity) followed by
+// x[0..capacity), so a consumer (e.g. JS via BigUint64Array views) can read
+// both halves without copying. The VOLE must be a split receiver
+// (set_soa_receiver), which extends straight into the two halves. Released
+// chunks are recycled for later leases of equal or smaller size.
+
+#include "emp-zk/emp-vole/utility.h"
+#include "emp-zk/emp-vole/vole_alloc.h"
+#include <climits>
+#include <vector>
+
+template <typename VoleT> class VoleChunkPool {
+public:
+  struct Chunk {
+    uint64_t *data = nullptr; // z[0..capacity) then x[0..capacity)
+    int64_t capacity = 0;
+    int64_t size = 0;
+    bool leased = false;
+  };
+
+  VoleT *vole;
+  std::vector<Chunk> chunks;
+
+  VoleChunkPool(VoleT *vole) : vole(vole) {
+    if (!vole->soa_receiver)
+      error("The chunk pool needs a split receiver (set_soa_receiver)");
+  }
+
+  ~VoleChunkPool() {
+    for (auto &c : chunks)
+      vole_free(c.data);
+  }
+
+  // Generate `count` VOLEs into a free chunk and return its id, or -1 for
+  // a count outside [1, INT_MAX]
+  int lease(int64_t count) {
+    if (count <= 0 || count > INT_MAX)
+      return -1;
+    int id = acquire(count);
+    Chunk &c = chunks[id];
+    vole->extend(c.data + c.capacity, c.data, (int)count);
+    c.size = count;
+    c.leased = true;
+    return id;
+  }
+
+  void release(int id) {
+    if (!valid(id))
+      return;
+    chunks[id].leased = false;
+    chunks[id].size = 0;
+  }
+
+  const uint64_t *z(int id) const {
+    return valid(id) ? chunks[id].data : nullptr;
+  }
+  const uint64_t *x(int id) const {
+    return valid(id) ? chunks[id].data + chunks[id].capacity : nullptr;
+  }
+  int64_t size(int id) const { return valid(id) ? chunks[id].size : 0; }
+
+  int leased_count() const {
+    int cnt = 0;
+    for (auto &c : chunks)
+      cnt += c.leased;
+    return cnt;
+  }
+
+private:
+  bool valid(int id) const {
+    return id >= 0 && id < (int)chunks.size() && chunks[id].leased;
+  }
+
+  // Best-fit reuse of a released chunk, otherwise allocate a new one
+  int acquire(int64_t count) {
+    int best = -1;
+    for (int i = 0; i < (int)chunks.size(); ++i) {
+      if (chunks[i].leased || chunks[i].capacity < count)
+        continue;
+      if (best < 0 || chunks[i].capacity < chunks[best].capacity)
+        best = i;
+    }
+    if (best >= 0)
+      return best;
+    Chunk c;
+    c.data = vole_alloc_array<uint64_t>(2 * count);
+    c.capacity = count;
+    chunks.push_back(c);
+    return (int)chunks.size() - 1;
+  }
+};
+
+#endif // VOLE_CHUNK_POOL_H__
@@ -0,0 +1,61 @@
+#ifndef VOLE_RING_H__
+#define VOLE_RING_H__
+
+// Exact-size views into one owned ring of extension rounds. Each round is
+// generated in place right after the outputs not yet handed out
+// (VoleTripleBlake3::extend(T *)), so there is no round buffer and no copy
+// into the caller's array: next(num) returns the next num outputs as one
+// contiguous view. When no round fits before the end of the ring, the
+// outputs not yet handed out (fewer than one view) move to its start; that
+// move is the only copy, counted as copy_bytes in the extend stats.
+
+#include "emp-zk/emp-vole/utility.h"
+#include "emp-zk/emp-vole/vole_alloc.h"
+#include <cstring>
+
+// T: __uint128_t, or uint64_t for a compact sender
+template <typename VoleT, typename T = __uint128_t> class VoleRing {
+public:
+  VoleT *vole;
+  T *buf = nullptr;
+  int64_t max_view, capacity;
+  int64_t head = 0, end = 0; // [head, end): generated, not handed out yet
+
+  // Views of up to max_view outputs. rounds: ot_limit-sized rounds of room
+  // past one view; more rounds move less often. Call after vole->setup().
+  VoleRing(VoleT *vole, int64_t max_view, int rounds = 1)
+      : vole(vole), max_view(max_view) {
+    if (max_view <= 0 || rounds < 1)
+      error("VoleRing needs a positive view size and round count");
+    capacity = max_view + (int64_t)rounds * vole->ot_limit + vole->M;
+    buf = vole_alloc_array<T>(capacity);
+  }
+
+  ~VoleRing() { vole_free(buf); }
+
+  // The next num outputs, valid until the next call
+  const T *next(int64_t num) {
+    if (num > max_view)
+      error("VoleRing view larger than max_view");
+    const int64_t n = vole->ot_limit + vole->M;
+    while (end - head < num) {
+      if (end + n > capacity) {
+        int64_t left = end - head;
+        memmove(buf, buf + head, left * sizeof(T));
+        vole->count_copy(left * (int64_t)sizeof(T));
+        head = 0;
+        end = left;
+      }
+      vole->extend(buf + end);
+      end += vole->ot_limit;
+    }
+    const T *view = buf + head;
+    head += num;
+    return view;
+  }
+
+  // Outputs generated but not handed out yet
+  int64_t available() const { return end - head; }
+};
+
+#endif // VOLE_RING_H__
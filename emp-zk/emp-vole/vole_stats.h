@@ -0,0 +1,194 @@
+#ifndef EMP_VOLE_STATS_H__
+#define EMP_VOLE_STATS_H__
+
+// Per-phase hot-path instrumentation. VOLE_PHASE(p) opens a scoped timer and
+// VOLE_COUNT(c, n) bumps a counter, both on the calling thread's current
+// VoleStats (installed by VoleStatsScope, which VoleTripleBlake3 does around
+// setup() and extend()). Time is charged exclusively: a nested phase pauses
+// the enclosing one, so the phases of a scope add up to its wall time. With
+// no VoleStats installed a timer costs one thread-local load; building with
+// -DVOLE_NO_STATS compiles them out, together with the vole_trace.h spans.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "vole_trace.h"
+
+namespace emp {
+
+enum VolePhase {
+  VOLE_PHASE_OTHER, // inside a VoleStatsScope but in no named phase
+  VOLE_PHASE_COT_GEN,
+  VOLE_PHASE_OT_PREHASH,
+  VOLE_PHASE_GGM_EXPAND,
+  VOLE_PHASE_NET_WAIT,
+  VOLE_PHASE_LPN_INDEX,
+  VOLE_PHASE_LPN_GATHER,
+  VOLE_PHASE_EA_ACCUMULATE,
+  VOLE_PHASE_CHECK,
+  VOLE_PHASE_N
+};
+
+enum VoleCounter {
+  VOLE_COUNT_COTS,
+  VOLE_COUNT_GGM_TREES,
+  VOLE_COUNT_LPN_ROWS,
+  VOLE_COUNT_RECV_CALLS,
+  VOLE_COUNT_ALLOCS, // operator new calls, vole_loopback/microbench
+  VOLE_COUNT_COPY_BYTES, // outputs moved between buffers after generation
+  VOLE_COUNT_N
+};
+
+inline const char *vole_phase_name(int p) {
+  static const char *names[VOLE_PHASE_N] = {
+      "other",    "cot_gen",    "ot_prehash", "ggm_expand",
+      "net_wait", "lpn_index", "lpn_gather", "ea_accum", "check"};
+  return names[p];
+}
+
+inline const char *vole_counter_name(int c) {
+  static const char *names[VOLE_COUNT_N] = {"cots", "ggm_trees", "lpn_rows",
+                                            "recv_calls", "allocs",
+                                            "copy_bytes"};
+  return names[c];
+}
+
+struct VoleStats {
+  int64_t ns[VOLE_PHASE_N] = {0};
+  int64_t calls[VOLE_PHASE_N] = {0};
+  int64_t count[VOLE_COUNT_N] = {0};
+  // Phase currently charged and when it was last charged
+  int cur = VOLE_PHASE_OTHER;
+  int64_t mark = 0;
+
+  void reset() { *this = VoleStats(); }
+
+  // Charges the time since the last switch to the current phase
+  void charge(int64_t now) {
+    ns[cur] += now - mark;
+    mark = now;
+  }
+
+  double ms(int p) const { return ns[p] / 1e6; }
+
+  double total_ms() const {
+    int64_t t = 0;
+    for (int p = 0; p < VOLE_PHASE_N; ++p)
+      t += ns[p];
+    return t / 1e6;
+  }
+
+  void print(const char *title) const {
+    double total = total_ms();
+    printf("%s: %.1f ms\n", title, total);
+    for (int p = 0; p < VOLE_PHASE_N; ++p)
+      if (ns[p] > 0)
+        printf("  %-11s %9.1f ms %5.1f%%  (%lld calls)\n", vole_phase_name(p),
+               ms(p), total > 0 ? 100 * ms(p) / total : 0.0,
+               (long long)calls[p]);
+    for (int c = 0; c < VOLE_COUNT_N; ++c)
+      if (count[c] > 0)
+        printf("  %-11s %12lld\n", vole_counter_name(c), (long long)count[c]);
+  }
+
+  // {"total_ms":..,"phases":{"cot_gen":{"ms":..,"calls":..},..},"counters":{..}}
+  std::string json() const {
+    std::string s;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"total_ms\":%.3f,\"phases\":{", total_ms());
+    s += buf;
+    for (int p = 0; p < VOLE_PHASE_N; ++p) {
+      snprintf(buf, sizeof(buf), "%s\"%s\":{\"ms\":%.3f,\"calls\":%lld}",
+               p ? "," : "", vole_phase_name(p), ms(p), (long long)calls[p]);
+      s += buf;
+    }
+    s += "},\"counters\":{";
+    for (int c = 0; c < VOLE_COUNT_N; ++c) {
+      snprintf(buf, sizeof(buf), "%s\"%s\":%lld", c ? "," : "",
+               vole_counter_name(c), (long long)count[c]);
+      s += buf;
+    }
+    s += "}}";
+    return s;
+  }
+};
+
+// The calling thread's current VoleStats, or nullptr
+inline VoleStats *&vole_stats_current() {
+  static thread_local VoleStats *cur = nullptr;
+  return cur;
+}
+
+// Installs stats as the current VoleStats for this thread until destroyed
+class VoleStatsScope {
+  VoleStats *stats, *prev;
+
+public:
+  explicit VoleStatsScope(VoleStats *stats)
+      : stats(stats), prev(vole_stats_current()) {
+    stats->cur = VOLE_PHASE_OTHER;
+    stats->mark = vole_now_ns();
+    vole_stats_current() = stats;
+  }
+  ~VoleStatsScope() {
+    stats->charge(vole_now_ns());
+    vole_stats_current() = prev;
+  }
+};
+
+// Also a trace span named after the phase while tracing is on
+class VolePhaseTimer {
+  VoleStats *stats;
+  int phase, prev = VOLE_PHASE_OTHER;
+  int64_t trace_start = 0;
+
+public:
+  explicit VolePhaseTimer(VolePhase p) : stats(vole_stats_current()), phase(p) {
+    bool traced = vole_trace_on();
+    if (stats == nullptr && !traced)
+      return;
+    int64_t now = vole_now_ns();
+    if (traced)
+      trace_start = now;
+    if (stats != nullptr) {
+      stats->charge(now);
+      prev = stats->cur;
+      stats->cur = p;
+      ++stats->calls[p];
+    }
+  }
+  ~VolePhaseTimer() {
+    if (stats == nullptr && trace_start == 0)
+      return;
+    int64_t now = vole_now_ns();
+    if (trace_start != 0 && vole_trace_on())
+      vole_trace_ring()->push(trace_start, now - trace_start,
+                              vole_phase_name(phase), -1);
+    if (stats != nullptr) {
+      stats->charge(now);
+      stats->cur = prev;
+    }
+  }
+};
+
+inline void vole_stats_count(VoleCounter c, int64_t n) {
+  VoleStats *s = vole_stats_current();
+  if (s != nullptr)
+    s->count[c] += n;
+}
+
+} // namespace emp
+
+#define VOLE_STATS_CAT2(a, b) a##b
+#define VOLE_STATS_CAT(a, b) VOLE_STATS_CAT2(a, b)
+
+#ifdef VOLE_NO_STATS
+#define VOLE_PHASE(p)
+#define VOLE_COUNT(c, n)
+#else
+#define VOLE_PHASE(p)                                                          \
+  emp::VolePhaseTimer VOLE_STATS_CAT(vole_phase_timer_, __LINE__)(emp::p)
+#define VOLE_COUNT(c, n) emp::vole_stats_count(emp::c, (n))
+#endif
+
+#endif // EMP_VOLE_STATS_H__
@@ -0,0 +1,207 @@
+#ifndef EMP_VOLE_TRACE_H__
+#define EMP_VOLE_TRACE_H__
+
+// Timeline tracing in Chrome trace-event format (chrome://tracing, Perfetto).
+// While tracing is on (vole_trace_start), every VOLE_PHASE timer plus the
+// VOLE_TRACE spans (setup stages, mpfss calls, LPN ranges, sends) append one
+// complete ("X") event, begin time plus duration, to a preallocated ring
+// owned by the calling thread. A full ring overwrites its oldest events.
+// vole_trace_json() collects all rings at the end of a session. Start and
+// collect while no session is running.
+//
+// Timestamps are CLOCK_MONOTONIC microseconds, not process-relative, so the
+// sender and receiver dumps of one host line up when loaded side by side.
+// pid is the party (vole_trace_label), so both fit in one viewer.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace emp {
+
+inline int64_t vole_now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct VoleTraceEvent {
+  int64_t ts_ns;
+  int64_t dur_ns;
+  const char *name; // string literal
+  int64_t arg;      // shown as args.n; -1 for none
+};
+
+class VoleTraceRing {
+public:
+  std::vector<VoleTraceEvent> ev;
+  uint64_t next = 0; // events written, including overwritten ones
+  int pid = 0;
+  int tid;
+
+  explicit VoleTraceRing(int tid) : tid(tid) {}
+
+  void push(int64_t ts_ns, int64_t dur_ns, const char *name, int64_t arg) {
+    VoleTraceEvent &e = ev[next % ev.size()];
+    e.ts_ns = ts_ns;
+    e.dur_ns = dur_ns;
+    e.name = name;
+    e.arg = arg;
+    ++next;
+  }
+};
+
+struct VoleTraceRegistry {
+  std::mutex m;
+  std::vector<std::unique_ptr<VoleTraceRing>> rings;
+  std::atomic<bool> on{false};
+  size_t capacity = 0;
+};
+
+inline VoleTraceRegistry &vole_trace_registry() {
+  static VoleTraceRegistry r;
+  return r;
+}
+
+inline bool vole_trace_on() {
+  return vole_trace_registry().on.load(std::memory_order_relaxed);
+}
+
+// This thread's ring, created and sized on first use. Rings outlive their
+// threads so a session can be dumped after its workers have joined.
+inline VoleTraceRing *vole_trace_ring() {
+  static thread_local VoleTraceRing *ring = nullptr;
+  VoleTraceRegistry &reg = vole_trace_registry();
+  if (ring == nullptr) {
+    std::lock_guard<std::mutex> lock(reg.m);
+    reg.rings.emplace_back(new VoleTraceRing((int)reg.rings.size()));
+    ring = reg.rings.back().get();
+  }
+  if (ring->ev.size() != reg.capacity) {
+    std::lock_guard<std::mutex> lock(reg.m);
+    ring->ev.assign(reg.capacity, VoleTraceEvent());
+    ring->next = 0;
+  }
+  return ring;
+}
+
+// Starts a new trace with capacity events per thread, dropping old events
+inline void vole_trace_start(size_t capacity = 1 << 18) {
+  VoleTraceRegistry &reg = vole_trace_registry();
+  std::lock_guard<std::mutex> lock(reg.m);
+  reg.capacity = capacity;
+  for (auto &r : reg.rings) {
+    r->ev.assign(capacity, VoleTraceEvent());
+    r->next = 0;
+  }
+  reg.on.store(true, std::memory_order_relaxed);
+}
+
+inline void vole_trace_stop() {
+  vole_trace_registry().on.store(false, std::memory_order_relaxed);
+}
+
+// Tags the calling thread's events with pid = party
+inline void vole_trace_label(int party) {
+  if (vole_trace_on())
+    vole_trace_ring()->pid = party;
+}
+
+// Scoped span; a no-op unless tracing was on when it opened
+class VoleTraceSpan {
+  const char *name;
+  int64_t arg;
+  int64_t start;
+
+public:
+  explicit VoleTraceSpan(const char *name, int64_t arg = -1)
+      : name(name), arg(arg), start(vole_trace_on() ? vole_now_ns() : 0) {}
+  ~VoleTraceSpan() { close(); }
+
+  // Ends this span and opens the next one at the same point
+  void next(const char *next_name, int64_t next_arg = -1) {
+    close();
+    name = next_name;
+    arg = next_arg;
+    start = vole_trace_on() ? vole_now_ns() : 0;
+  }
+
+private:
+  void close() {
+    if (start != 0 && vole_trace_on())
+      vole_trace_ring()->push(start, vole_now_ns() - start, name, arg);
+    start = 0;
+  }
+};
+
+// {"traceEvents":[...]} with every ring's events, oldest first per thread
+inline std::string vole_trace_json() {
+  VoleTraceRegistry &reg = vole_trace_registry();
+  std::lock_guard<std::mutex> lock(reg.m);
+  std::string s = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  char buf[256];
+  bool first = true;
+  std::vector<int> pids;
+  for (auto &r : reg.rings) {
+    if (r->next == 0)
+      continue;
+    if (std::find(pids.begin(), pids.end(), r->pid) == pids.end()) {
+      pids.push_back(r->pid);
+      snprintf(buf, sizeof(buf),
+               "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+               "\"args\":{\"name\":\"%s\"}}",
+               first ? "" : ",", r->pid,
+               r->pid == 1 ? "ALICE" : r->pid == 2 ? "BOB" : "VOLE");
+      s += buf;
+      first = false;
+    }
+    uint64_t n = std::min<uint64_t>(r->next, r->ev.size());
+    for (uint64_t i = r->next - n; i < r->next; ++i) {
+      const VoleTraceEvent &e = r->ev[i % r->ev.size()];
+      int len = snprintf(buf, sizeof(buf),
+                         "%s{\"name\":\"%s\",\"cat\":\"vole\",\"ph\":\"X\","
+                         "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+                         first ? "" : ",", e.name, e.ts_ns / 1e3,
+                         e.dur_ns / 1e3, r->pid, r->tid);
+      if (e.arg >= 0)
+        snprintf(buf + len, sizeof(buf) - len, ",\"args\":{\"n\":%lld}}",
+                 (long long)e.arg);
+      else
+        snprintf(buf + len, sizeof(buf) - len, "}");
+      s += buf;
+      first = false;
+    }
+  }
+  s += "]}";
+  return s;
+}
+
+inline bool vole_trace_dump(const char *path) {
+  std::string json = vole_trace_json();
+  FILE *f = fopen(path, "w");
+  if (f == nullptr)
+    return false;
+  bool ok = fwrite(json.data(), 1, json.size(), f) == json.size();
+  return fclose(f) == 0 && ok;
+}
+
+} // namespace emp
+
+#define VOLE_TRACE_CAT2(a, b) a##b
+#define VOLE_TRACE_CAT(a, b) VOLE_TRACE_CAT2(a, b)
+
+#ifdef VOLE_NO_STATS
+#define VOLE_TRACE(...)
+#else
+// VOLE_TRACE("name") or VOLE_TRACE("name", n): span to the end of the scope
+#define VOLE_TRACE(...)                                                        \
+  emp::VoleTraceSpan VOLE_TRACE_CAT(vole_trace_span_, __LINE__)(__VA_ARGS__)
+#endif
+
+#endif // EMP_VOLE_TRACE_H__
@@ -5,36 +5,105 @@
 
 #include "emp-zk/emp-vole/base_svole_direct_mock.h"
 #include "emp-zk/emp-vole/base_cot_mock.h"
+#include "emp-zk/emp-vole/ea_code_blake3.h"
 #include "emp-zk/emp-vole/lpn_blake3.h"
+#include "emp-zk/emp-vole/lpn_param_blake3.h"
 #include "emp-zk/emp-vole/mpfss_reg_blake3.h"
+#include "emp-zk/emp-vole/vole_alloc.h"
+#include "emp-zk/emp-vole/vole_stats.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// One long-lived thread running one job at a time: the next-round prefetch
+// of a pipelined VoleTripleBlake3 (the shim's ThreadPool runs tasks inline).
+// Without threads (wasm) run() runs the job inline.
+class VoleWorker {
+  std::thread th;
+  std::mutex m;
+  std::condition_variable cv;
+  std::function<void()> job;
+  bool busy = false, stop = false;
 
-class PrimalLPNParameterFp61Blake3 {
 public:
-  int64_t n, t, k, log_bin_sz;
-  int64_t n_pre, t_pre, k_pre, log_bin_sz_pre;
-  int64_t n_pre0, t_pre0, k_pre0, log_bin_sz_pre0;
-
-  PrimalLPNParameterFp61Blake3() {}
-  PrimalLPNParameterFp61Blake3(int64_t n, int64_t t, int64_t k, int64_t log_bin_sz,
-                               int64_t n_pre, int64_t t_pre, int64_t k_pre,
-                               int64_t log_bin_sz_pre, int64_t n_pre0, int64_t t_pre0,
-                               int64_t k_pre0, int64_t log_bin_sz_pre0)
-      : n(n), t(t), k(k), log_bin_sz(log_bin_sz), n_pre(n_pre), t_pre(t_pre),
-        k_pre(k_pre), log_bin_sz_pre(log_bin_sz_pre), n_pre0(n_pre0),
-        t_pre0(t_pre0), k_pre0(k_pre0), log_bin_sz_pre0(log_bin_sz_pre0) {
-
-    if (n != t * (1 << log_bin_sz) || n_pre != t_pre * (1 << log_bin_sz_pre) ||
-        n_pre < k + t + 1)
-      error("LPN parameter not matched");
-  }
-  int64_t buf_sz() const { return n - t - k - 1; }
+  ~VoleWorker() {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      stop = true;
+    }
+    cv.notify_all();
+    if (th.joinable())
+      th.join();
+  }
+
+  void run(std::function<void()> f) {
+#ifdef __EMSCRIPTEN__
+    f();
+#else
+    if (!th.joinable())
+      th = std::thread([this]() { loop(); });
+    {
+      std::lock_guard<std::mutex> lock(m);
+      job = std::move(f);
+      busy = true;
+    }
+    cv.notify_all();
+#endif
+  }
+
+  // Returns once the last job has finished
+  void wait() {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [this]() { return !busy; });
+  }
+
+private:
+  void loop() {
+    std::unique_lock<std::mutex> lock(m);
+    for (;;) {
+      cv.wait(lock, [this]() { return busy || stop; });
+      if (!busy)
+        return;
+      std::function<void()> f = std::move(job);
+      lock.unlock();
+      f();
+      lock.lock();
+      busy = false;
+      cv.notify_all();
+    }
+  }
 };
 
-const static PrimalLPNParameterFp61Blake3 fp_default_blake3 = PrimalLPNParameterFp61Blake3(
-    10168320, 4965, 158000, 11, 166400, 2600, 5060, 6, 9600, 600, 1220, 4);
+// Recoveries of a resumable VoleTripleBlake3 (set_resumable)
+struct VoleResumeStats {
+  int64_t drops = 0;        // connections lost and re-established
+  int64_t replays = 0;      // steps run again for a peer one step behind
+  double recover_ms = 0;    // reconnect to step restart, all drops
+  double recover_max_ms = 0;
+  double replay_ms = 0;     // of recover_ms, spent in replays
+};
 
-template <typename IO> class VoleTripleBlake3 {
+// Param = LpnParamFixed<...> (e.g. FpDefaultBlake3Fixed) compiles every stage
+// for its sizes; LpnParamDynamic accepts any PrimalLPNParameterFp61Blake3.
+// Prp = HalfTreePRP_Blake3 builds the GGM trees with one hash per node; both
+// parties must agree on it. set_dual_ea() swaps the primal final stage for
+// expand-accumulate compression (ea_code_blake3.h). set_compact_sender()
+// makes ALICE keep its outputs as packed 64-bit words, set_soa_receiver()
+// makes BOB keep its x and z words in two separate arrays. set_pipeline()
+// overlaps each round's LPN with the next round's COTs and choice flight.
+// set_resumable() survives lost connections by running setup or the
+// interrupted round again after a reconnect; finish() closes such a session.
+template <typename IO, typename Param = LpnParamDynamic,
+          typename Prp = TwoKeyPRP_Blake3>
+class VoleTripleBlake3 {
 public:
+  typedef typename Param::final_stage FinalStage;
+  typedef typename Param::pre_stage PreStage;
+  typedef typename Param::pre0_stage Pre0Stage;
+
   IO *io;
   IO **ios;
   int party;
@@ -56,20 +125,84 @@ public:
 
   // OT consumption tracking
   int64_t ot_consumed = 0;
+  // Whole rounds run by extend, whichever call asked for them
+  int64_t rounds_extended = 0;
+  // Caller buffer holding the outputs extend_inplace kept (ot_used of the
+  // round) and where they start; nullptr when they sit in the round buffer
+  void *inplace_buf = nullptr;
+  int64_t inplace_at = 0;
 
   __uint128_t Delta;
-  LpnFpBlake3<10> *lpn = nullptr;
+  // Set by set_seed: receiver randomness (MPFSS check seeds, SPFSS choice
+  // positions) is derived from seed instead of the system RNG
+  bool deterministic = false;
+  block seed = zero_block;
+  // Set by set_fiat_shamir: MPFSS check challenges come from the transcript
+  // and each check rides on the next run's flights (MpfssFsState)
+  bool fiat_shamir = false;
+  MpfssFsState fs_state;
+  // Set by set_dual_ea: each round compresses a code_n-long MPFSS output
+  // (ea_noise, the y or z words) into param.n VOLEs instead of adding it to
+  // primal LPN. The round's M keys go to MPFSS as 64-bit words (ea_keys: y
+  // words, or M x words then M z words) and BOB's punctured positions to
+  // the code (ea_at).
+  bool dual_ea = false;
+  EaCodeFpBlake3<10> *ea = nullptr;
+  uint64_t *ea_noise = nullptr;
+  std::vector<uint64_t> ea_keys;
+  std::vector<int64_t> ea_at;
+  // Set by set_compact_sender: ALICE's pre-VOLEs and buffered outputs are
+  // packed 64-bit words (the high half of a sender element is always 0)
+  bool compact_sender = false;
+  uint64_t *pre_y64 = nullptr;
+  uint64_t *vole_y64 = nullptr;
+  // Set by set_soa_receiver: BOB's pre-VOLEs and buffered outputs are two
+  // uint64_t arrays, the x words and the z words
+  bool soa_receiver = false;
+  uint64_t *pre_x64 = nullptr, *pre_z64 = nullptr;
+  uint64_t *vole_x64 = nullptr, *vole_z64 = nullptr;
+  // Set by set_pipeline: while a round's LPN runs, prefetcher generates the
+  // next round's COTs into pre_ot_next and sends its MPFSS choice flight;
+  // the two OTPre then swap
+  bool pipeline = false;
+  OTPre<IO> *pre_ot_next = nullptr;
+  bool prefetched = false;
+  VoleWorker *prefetcher = nullptr;
+  LpnFpBlake3<10, FinalStage> *lpn = nullptr;
   ThreadPool *pool = nullptr;
-  MpfssRegFpBlake3<IO> *mpfss = nullptr;
+  MpfssRegFpBlake3<IO, FinalStage, Prp> *mpfss = nullptr;
+  // Per-phase time and counters of setup() and of all extend rounds so far
+  // (vole_stats.h), and of the pipelined prefetches
+  VoleStats setup_stats, extend_stats, prefetch_stats;
+  // Set by set_resumable: setup() is step 0 and extend round i is step i.
+  // Each step starts with a checkpoint of the state it changes; when the
+  // connection is lost (VoleConnectionLost) both parties reconnect, agree
+  // on a step with (session_id, step) and run it again from its checkpoint.
+  // finish() adds a closing step, during which closing is set
+  bool resumable = false;
+  bool closing = false;
+  int max_reconnects = 8;
+  block session_id = zero_block;
+  int64_t step = 0;
+  VoleResumeStats resume_stats;
+
+  // Named parameter set from fp_blake3_profiles ("default", "medium", ...)
+  // or a "select:TARGET:BUDGET_MB" choice (lpn_param_lookup_fp61)
+  VoleTripleBlake3(int party, int threads, IO **ios, const char *profile)
+      : VoleTripleBlake3(party, threads, ios, profile_param(profile)) {}
+
+  VoleTripleBlake3(int party, int threads, IO **ios)
+      : VoleTripleBlake3(party, threads, ios, default_param()) {}
 
   VoleTripleBlake3(int party, int threads, IO **ios,
-                   PrimalLPNParameterFp61Blake3 param = fp_default_blake3) {
+                   PrimalLPNParameterFp61Blake3 param) {
     this->io = ios[0];
     this->threads = threads;
     this->party = party;
     this->ios = ios;
     this->param = param;
     this->extend_initialized = false;
+    vole_trace_label(party);
 
     cot = new BaseCotMock<IO>(party, io, true);
     cot->cot_gen_pre();
@@ -89,26 +222,123 @@ public:
   }
 
   ~VoleTripleBlake3() {
-    if (pre_yz != nullptr)
-      delete[] pre_yz;
-    if (pre_x != nullptr)
-      delete[] pre_x;
+    delete prefetcher;
+    delete pre_ot_next;
+    vole_free(pre_yz);
+    vole_free(pre_x);
     if (pre_ot != nullptr)
       delete pre_ot;
     if (lpn != nullptr)
       delete lpn;
+    if (ea != nullptr)
+      delete ea;
+    vole_free(ea_noise);
     if (pool != nullptr)
       delete pool;
     if (mpfss != nullptr)
       delete mpfss;
-    if (vole_triples != nullptr)
-      delete[] vole_triples;
-    if (vole_x != nullptr)
-      delete[] vole_x;
+    vole_free(vole_triples);
+    vole_free(vole_x);
+    vole_free(pre_y64);
+    vole_free(vole_y64);
+    vole_free(pre_x64);
+    vole_free(pre_z64);
+    vole_free(vole_x64);
+    vole_free(vole_z64);
     if (cot != nullptr)
       delete cot;
   }
 
+  // Makes a session reproducible from its peer's messages alone, e.g. for
+  // replaying a recorded transcript (transcript_io.h). Call before setup().
+  void set_seed(block s) {
+    deterministic = true;
+    seed = s;
+  }
+
+  // Saves the setup round trips of the malicious checks; both parties must
+  // call it. Call before setup(). The sender can grind transcript
+  // challenges offline, so each MPFSS run checks kMpfssCheckMasks
+  // independent ones instead of one (MpfssFsState).
+  void set_fiat_shamir() { fiat_shamir = true; }
+
+  // Dual-LPN final stage with the same outputs per round; param's final
+  // stage is rewritten by ea_param_fp61. It sends about 3.5x less from
+  // ALICE to BOB than primal LPN, at the cost of a 2n-word noise vector
+  // and roughly 3x the extend time. Both parties must call it before
+  // setup().
+  void set_dual_ea() {
+    if (Param::fixed)
+      error("Dual-LPN mode runs with runtime parameters only");
+    if (compact_sender || soa_receiver)
+      error("Dual-LPN mode extends into 128-bit buffers");
+    dual_ea = true;
+    param = ea_param_fp61(param);
+  }
+
+  // ALICE only: extend into uint64_t buffers, halving the sender's output,
+  // pre-VOLE and LPN memory traffic. Call before setup(); the receiver is
+  // unaffected.
+  void set_compact_sender() {
+    if (party != ALICE)
+      error("Only the sender has 64-bit outputs");
+    if (dual_ea)
+      error("Dual-LPN mode extends into 128-bit buffers");
+    compact_sender = true;
+  }
+
+  // BOB only: extend into separate x and z arrays (structure of arrays), so
+  // the LPN gathers and consumers that need one half read 8-byte words.
+  // Call before setup(); the sender is unaffected.
+  void set_soa_receiver() {
+    if (party != BOB)
+      error("Only the receiver has split x/z outputs");
+    if (dual_ea)
+      error("Dual-LPN mode extends into 128-bit buffers");
+    soa_receiver = true;
+  }
+
+  // Back-to-back extends: each round's COT generation and MPFSS choice
+  // flight for the next round run on a second thread during this round's
+  // LPN. The last round's prefetch waits for the next extend call. Both
+  // parties must call it before setup().
+  void set_pipeline() {
+    if (resumable)
+      error("Resumable sessions run one round at a time");
+    pipeline = true;
+  }
+
+  // Reconnects and resumes from the start of the interrupted step when the
+  // IO throws VoleConnectionLost, up to max_reconnects times in a row. A
+  // peer that finished the step is one step ahead and runs its last step
+  // again, so randomness is drawn from a seed (set_seed, or a private
+  // random one) and replays resend the same messages. Both parties must
+  // call it before setup(); the IO needs reconnect() (NetIO, LocalIO).
+  void set_resumable() {
+    if (pipeline)
+      error("Resumable sessions run one round at a time");
+    if (threads > 1)
+      error("Resumable sessions run on one connection");
+    resumable = true;
+    PRG prg;
+    if (!deterministic) {
+      block s;
+      prg.random_block(&s, 1);
+      set_seed(s);
+    }
+    if (party == ALICE)
+      prg.random_block(&session_id, 1);
+  }
+
+  template <typename MPFSS> void seed_mpfss(MPFSS *m, uint64_t stage) {
+    if (fiat_shamir)
+      m->set_fiat_shamir(&fs_state);
+    if (!deterministic)
+      return;
+    block s = seed ^ makeBlock(0, stage);
+    m->prg.reseed(&s);
+  }
+
   void setup(__uint128_t delta) {
     this->Delta = delta;
     setup();
@@ -124,53 +354,423 @@ public:
   }
 
   void extend_initialization() {
-    lpn = new LpnFpBlake3<10>(param.n, param.k, pool, pool->size());
-    mpfss = new MpfssRegFpBlake3<IO>(party, threads, param.n, param.t,
-                                     param.log_bin_sz, pool, ios);
+    int64_t noise_n = param.n;
+    if (dual_ea) {
+      noise_n = ea_code_n_fp61(param);
+      ea = new EaCodeFpBlake3<10>(param.n, param.t, param.log_bin_sz, pool,
+                                  pool->size());
+      ea_noise = vole_alloc_array<uint64_t>(noise_n);
+    } else {
+      lpn = new LpnFpBlake3<10, FinalStage>(param.n, param.k, pool,
+                                            pool->size());
+    }
+    mpfss = new MpfssRegFpBlake3<IO, FinalStage, Prp>(
+        party, threads, noise_n, param.t, param.log_bin_sz, pool, ios);
     mpfss->set_malicious();
+    if (compact_sender || (dual_ea && party == ALICE))
+      mpfss->set_compact_sender();
+    if (soa_receiver || (dual_ea && party == BOB))
+      mpfss->set_soa_receiver();
+    seed_mpfss(mpfss, 2);
 
     pre_ot = new OTPre<IO>(io, mpfss->tree_height - 1, mpfss->tree_n);
-    M = param.k + param.t + 1;
+    if (pipeline) {
+      pre_ot_next = new OTPre<IO>(io, mpfss->tree_height - 1, mpfss->tree_n);
+      prefetcher = new VoleWorker();
+    }
+    // Masks for kMpfssCheckMasks challenges even without Fiat-Shamir,
+    // where one is used (check_n): the two spare base VOLEs a run keep M,
+    // ot_limit and buf_sz() the same in both modes, so the profile tables
+    // and the peers' layout do not depend on the check mode
+    M = param.k + param.t + kMpfssCheckMasks;
+    if (dual_ea) {
+      ea_keys.resize(party == ALICE ? M : 2 * M);
+      if (party == BOB)
+        ea_at.resize(param.t);
+    }
     ot_limit = param.n - M;
     ot_used = ot_limit;
     extend_initialized = true;
   }
 
-  void extend_send(__uint128_t *y, MpfssRegFpBlake3<IO> *mpfss, OTPre<IO> *pre_ot,
-                   LpnFpBlake3<10> *lpn, __uint128_t *key) {
+  template <typename MPFSS, typename LPN>
+  void extend_send(__uint128_t *y, MPFSS *mpfss, OTPre<IO> *pre_ot, LPN *lpn,
+                   __uint128_t *key) {
     mpfss->sender_init(Delta);
     mpfss->mpfss(pre_ot, key, y);
-    lpn->compute_send(y, key + mpfss->tree_n + 1);
+    lpn->compute_send(y, key + mpfss->tree_n + kMpfssCheckMasks);
   }
 
-  void extend_recv(__uint128_t *z, MpfssRegFpBlake3<IO> *mpfss, OTPre<IO> *pre_ot,
-                   LpnFpBlake3<10> *lpn, __uint128_t *mac) {
+  template <typename MPFSS, typename LPN>
+  void extend_recv(__uint128_t *z, MPFSS *mpfss, OTPre<IO> *pre_ot, LPN *lpn,
+                   __uint128_t *mac) {
     mpfss->recver_init();
     mpfss->mpfss(pre_ot, mac, z);
-    lpn->compute_recv(z, mac + mpfss->tree_n + 1);
+    lpn->compute_recv(z, mac + mpfss->tree_n + kMpfssCheckMasks);
   }
 
-  void extend(__uint128_t *buffer) {
+  // The round's COTs, unless the previous round prefetched them
+  void round_cots() {
+    if (prefetched) {
+      prefetched = false;
+      return;
+    }
     cot->cot_gen(pre_ot, pre_ot->n);
     ot_consumed += pre_ot->n;
-    if (party == ALICE)
-      extend_send(buffer, mpfss, pre_ot, lpn, pre_yz);
-    else
-      extend_recv(buffer, mpfss, pre_ot, lpn, pre_yz);
-    memcpy(pre_yz, buffer + ot_limit, M * sizeof(__uint128_t));
+  }
+
+  // Pipelined rounds: starts the next round's COTs and choice flight. Runs
+  // after this round's MPFSS, so its OT messages and checks have gone out.
+  void prefetch_round() {
+    if (!pipeline)
+      return;
+    ot_consumed += pre_ot_next->n;
+    vole_io_fork(io, 0);
+    prefetcher->run([this]() {
+      vole_io_enter(io, 0);
+      VoleStatsScope stats_scope(&prefetch_stats);
+      vole_trace_label(party);
+      VOLE_TRACE("prefetch", pre_ot_next->n);
+      cot->cot_gen(pre_ot_next, pre_ot_next->n);
+      if (party == ALICE)
+        mpfss->sender_init(Delta);
+      else
+        mpfss->recver_init();
+      mpfss->prepare(pre_ot_next);
+    });
+  }
+
+  // Waits for the prefetch before the IO of this round's last check
+  void join_prefetch() {
+    if (!pipeline)
+      return;
+    prefetcher->wait();
+    vole_io_join(io, 0);
+    std::swap(pre_ot, pre_ot_next);
+    prefetched = true;
+  }
+
+  // State a step changes, saved at its start (set_resumable)
+  struct Checkpoint {
+    int64_t step = -1;
+    PRG cot_prg, mpfss_prg;
+    uint64_t recv_counter = 0;
+    MpfssFsState fs;
+    int64_t ot_consumed = 0;
+    std::vector<uint64_t> carry; // the M carried pre-VOLEs, storage words
+  };
+  // Start of the current step and of the previous one, and the replay of
+  // the previous step
+  Checkpoint cp[2];
+  std::function<void()> prev_replay;
+
+  // Calls f(words, count) on each array of the carried pre-VOLEs
+  template <typename F> void carry_arrays(F f) {
+    if (pre_yz != nullptr)
+      f((uint64_t *)pre_yz, 2 * (int64_t)M);
+    if (pre_y64 != nullptr)
+      f(pre_y64, (int64_t)M);
+    if (pre_x64 != nullptr) {
+      f(pre_x64, (int64_t)M);
+      f(pre_z64, (int64_t)M);
+    }
+  }
+
+  void save(Checkpoint &c) {
+    c.step = step;
+    c.cot_prg = cot->sync_prg;
+    if (party == BOB) // the counter is static, shared by parties in one process
+      c.recv_counter = SpfssRecverCounterFpBlake3<IO>::instance_counter;
+    c.fs = fs_state;
+    c.ot_consumed = ot_consumed;
+    c.carry.clear();
+    if (step == 0)
+      return; // setup_stages() starts over by itself
+    c.mpfss_prg = mpfss->prg;
+    carry_arrays([&c](uint64_t *w, int64_t n) {
+      c.carry.insert(c.carry.end(), w, w + n);
+    });
+    count_copy((int64_t)c.carry.size() * sizeof(uint64_t));
+  }
+
+  void restore(const Checkpoint &c) {
+    cot->sync_prg = c.cot_prg;
+    if (party == BOB)
+      SpfssRecverCounterFpBlake3<IO>::instance_counter = c.recv_counter;
+    fs_state = c.fs;
+    ot_consumed = c.ot_consumed;
+    if (c.step == 0)
+      return;
+    mpfss->prg = c.mpfss_prg;
+    mpfss->prepared = nullptr;
+    pre_ot->reset(); // an interrupted choice flight leaves its count
+    const uint64_t *src = c.carry.data();
+    carry_arrays([&src](uint64_t *w, int64_t n) {
+      memcpy(w, src, n * sizeof(uint64_t));
+      src += n;
+    });
+    count_copy((int64_t)c.carry.size() * sizeof(uint64_t));
+  }
+
+  // Runs one step (setup or an extend round); resumable sessions run it
+  // again after each lost connection. replay runs the step for a peer left
+  // one step behind: an extend round replays into scratch, as the caller
+  // may have freed or reused its buffer since
+  template <typename F, typename R> void run_step(F body, R replay) {
+    if (!resumable) {
+      body();
+      return;
+    }
+    std::swap(cp[0], cp[1]);
+    save(cp[0]);
+    for (;;) {
+      try {
+        body();
+        break;
+      } catch (const VoleConnectionLost &) {
+        if (!resume())
+          break;
+      }
+    }
+    prev_replay = replay;
+    ++step;
+  }
+
+  // Reconnects and brings both parties to the start of this step: a peer
+  // still in the previous step gets it replayed from cp[1] first. False if
+  // the peer is gone in the closing step: it only leaves once it has our
+  // confirmation, so it finished every round.
+  bool resume() {
+    auto t0 = std::chrono::steady_clock::now();
+    bool peer_here = true;
+    for (int attempt = 0;; ++attempt) {
+      if (attempt == max_reconnects)
+        error("Cannot resume the session");
+      try {
+        if (!vole_io_reconnect(io, 0)) {
+          if (!closing)
+            continue;
+          peer_here = false;
+          break;
+        }
+        ++resume_stats.drops;
+        int64_t peer = handshake();
+        if (peer == step - 1) {
+          auto r0 = std::chrono::steady_clock::now();
+          restore(cp[1]);
+          prev_replay();
+          ++resume_stats.replays;
+          resume_stats.replay_ms += std::chrono::duration<double, std::milli>(
+                                        std::chrono::steady_clock::now() - r0)
+                                        .count();
+        } else if (peer != step && peer != step + 1) {
+          error("Peers lost track of the session step");
+        }
+        restore(cp[0]);
+        break;
+      } catch (const VoleConnectionLost &) {
+      }
+    }
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count();
+    resume_stats.recover_ms += ms;
+    resume_stats.recover_max_ms = std::max(resume_stats.recover_max_ms, ms);
+    return peer_here;
+  }
+
+  // Closes a resumable session (set_resumable) with one more step in which
+  // the parties confirm to each other that they finished every round. A
+  // party that returned from its last extend stays reconnectable until
+  // then, so a drop that cost its peer the last message of that round is
+  // replayed like any other. Both parties call it after their last extend,
+  // after the same number of rounds; it does nothing for other sessions.
+  void finish() {
+    if (!resumable)
+      return;
+    closing = true;
+    auto close = [this]() {
+      int64_t peer_step;
+      io->send_data(&step, sizeof(int64_t));
+      io->flush();
+      io->recv_data(&peer_step, sizeof(int64_t));
+      if (peer_step != step)
+        error("Peers closed the session at different steps");
+    };
+    run_step(close, close); // no step follows, so it is never replayed
+    closing = false;
+  }
+
+  // Swaps (session_id, step) with the peer on a fresh connection; returns
+  // the peer's step. BOB learns the session in setup, or here at step 0.
+  int64_t handshake() {
+    block peer_id;
+    int64_t peer_step;
+    io->send_data(&session_id, sizeof(block));
+    io->send_data(&step, sizeof(int64_t));
+    io->flush();
+    io->recv_data(&peer_id, sizeof(block));
+    io->recv_data(&peer_step, sizeof(int64_t));
+    if (party == BOB && step == 0)
+      session_id = peer_id;
+    else if (peer_step > 0 && !cmpBlock(&peer_id, &session_id, 1))
+      error("Reconnected to another session");
+    return peer_step;
+  }
+
+  void extend(__uint128_t *buffer) {
+    if (compact_sender || soa_receiver)
+      error("Split or compact storage extends into uint64_t buffers");
+    VoleStatsScope stats_scope(&extend_stats);
+    VOLE_TRACE("extend", param.n);
+    auto round = [this](__uint128_t *buffer) {
+      round_cots();
+      if (dual_ea) {
+        ea_round(buffer);
+      } else if (party == ALICE) {
+        mpfss->sender_init(Delta);
+        mpfss->mpfss(pre_ot, pre_yz, buffer);
+        prefetch_round();
+        lpn->compute_send(buffer, pre_yz + mpfss->tree_n + kMpfssCheckMasks);
+      } else {
+        mpfss->recver_init();
+        mpfss->mpfss(pre_ot, pre_yz, buffer);
+        prefetch_round();
+        lpn->compute_recv(buffer, pre_yz + mpfss->tree_n + kMpfssCheckMasks);
+      }
+      join_prefetch();
+      mpfss->finish_check();
+      memcpy(pre_yz, buffer + ot_limit, M * sizeof(__uint128_t));
+      count_copy(M * sizeof(__uint128_t));
+    };
+    run_step([round, buffer]() { round(buffer); }, [this, round]() {
+      VoleBuffer<__uint128_t> scratch(param.n);
+      round(scratch.data());
+    });
+    ++rounds_extended;
+  }
+
+  // Dual-LPN round up to the check: MPFSS into the 64-bit noise from the
+  // carried keys, then the EA code into buffer
+  void ea_round(__uint128_t *buffer) {
+    uint64_t *kx = ea_keys.data(), *kz = kx + M;
+    if (party == ALICE) {
+      for (int i = 0; i < M; ++i)
+        kx[i] = (uint64_t)pre_yz[i];
+      mpfss->sender_init(Delta);
+      mpfss->mpfss(pre_ot, kx, ea_noise);
+      prefetch_round();
+      ea->encode_send(buffer, ea_noise);
+    } else {
+      for (int i = 0; i < M; ++i) {
+        kx[i] = (uint64_t)(pre_yz[i] >> 64);
+        kz[i] = (uint64_t)pre_yz[i];
+      }
+      mpfss->recver_init();
+      mpfss->mpfss(pre_ot, kx, kz, nullptr, ea_noise);
+      for (int i = 0; i < param.t; ++i)
+        ea_at[i] = mpfss->punctured(i);
+      prefetch_round();
+      ea->encode_recv(buffer, ea_noise, ea_at.data(), kx);
+    }
+  }
+
+  // Compact sender round: buffer[0, param.n) receives the y values
+  void extend(uint64_t *buffer) {
+    if (!compact_sender)
+      error("Call set_compact_sender before extending into uint64_t");
+    VoleStatsScope stats_scope(&extend_stats);
+    VOLE_TRACE("extend", param.n);
+    auto round = [this](uint64_t *buffer) {
+      round_cots();
+      mpfss->sender_init(Delta);
+      mpfss->mpfss(pre_ot, pre_y64, buffer);
+      prefetch_round();
+      lpn->compute_send(buffer, pre_y64 + mpfss->tree_n + kMpfssCheckMasks);
+      join_prefetch();
+      mpfss->finish_check();
+      memcpy(pre_y64, buffer + ot_limit, M * sizeof(uint64_t));
+      count_copy(M * sizeof(uint64_t));
+    };
+    run_step([round, buffer]() { round(buffer); }, [this, round]() {
+      VoleBuffer<uint64_t> scratch(param.n);
+      round(scratch.data());
+    });
+    ++rounds_extended;
+  }
+
+  // Split receiver round: x[0, param.n) and z[0, param.n) receive the x and
+  // z words
+  void extend(uint64_t *x, uint64_t *z) {
+    if (!soa_receiver)
+      error("Call set_soa_receiver before extending into x/z arrays");
+    VoleStatsScope stats_scope(&extend_stats);
+    VOLE_TRACE("extend", param.n);
+    auto round = [this](uint64_t *x, uint64_t *z) {
+      round_cots();
+      int t1 = mpfss->tree_n + kMpfssCheckMasks;
+      mpfss->recver_init();
+      mpfss->mpfss(pre_ot, pre_x64, pre_z64, x, z);
+      prefetch_round();
+      lpn->compute_recv(x, z, pre_x64 + t1, pre_z64 + t1);
+      join_prefetch();
+      mpfss->finish_check();
+      memcpy(pre_x64, x + ot_limit, M * sizeof(uint64_t));
+      memcpy(pre_z64, z + ot_limit, M * sizeof(uint64_t));
+      count_copy(2 * M * sizeof(uint64_t));
+    };
+    run_step([round, x, z]() { round(x, z); }, [this, round]() {
+      VoleBuffer<uint64_t> scratch(2 * param.n);
+      round(scratch.data(), scratch.data() + param.n);
+    });
+    ++rounds_extended;
   }
 
   void setup() {
+    VoleStatsScope stats_scope(&setup_stats);
+    VOLE_TRACE("setup");
+    run_step([this]() { setup_stages(); }, [this]() { setup_stages(); });
+  }
+
+  // The pre-VOLE stages of setup(); runs again from the top on a resume
+  void setup_stages() {
+    if (deterministic && party == BOB)
+      SpfssRecverCounterFpBlake3<IO>::instance_counter = 0;
+    fs_state = MpfssFsState();
+    for (uint64_t **p : {&pre_y64, &pre_x64, &pre_z64}) {
+      vole_free(*p);
+      *p = nullptr;
+    }
+    vole_free(pre_yz);
+    pre_yz = nullptr;
+    if (resumable) {
+      if (party == ALICE) {
+        io->send_data(&session_id, sizeof(block));
+        io->flush();
+      } else {
+        io->recv_data(&session_id, sizeof(block));
+      }
+    }
     ThreadPool pool_tmp(1);
-    auto fut = pool_tmp.enqueue([this]() { extend_initialization(); });
+    auto fut = pool_tmp.enqueue([this]() {
+      if (extend_initialized)
+        seed_mpfss(mpfss, 2);
+      else
+        extend_initialization();
+    });
 
-    __uint128_t *pre_yz0 = new __uint128_t[param.n_pre0];
+    VoleTraceSpan stage_span("stage0", param.n_pre0);
+    VoleBuffer<__uint128_t> yz0(param.n_pre0);
+    __uint128_t *pre_yz0 = yz0.data();
     memset(pre_yz0, 0, param.n_pre0 * sizeof(__uint128_t));
 
-    LpnFpBlake3<10> lpn_pre0(param.n_pre0, param.k_pre0, pool, pool->size());
-    MpfssRegFpBlake3<IO> mpfss_pre0(party, threads, param.n_pre0, param.t_pre0,
-                                    param.log_bin_sz_pre0, pool, ios);
+    LpnFpBlake3<10, Pre0Stage> lpn_pre0(param.n_pre0, param.k_pre0, pool,
+                                        pool->size());
+    MpfssRegFpBlake3<IO, Pre0Stage, Prp> mpfss_pre0(
+        party, threads, param.n_pre0, param.t_pre0, param.log_bin_sz_pre0, pool,
+        ios);
     mpfss_pre0.set_malicious();
+    seed_mpfss(&mpfss_pre0, 0);
     OTPre<IO> pre_ot_ini0(ios[0], mpfss_pre0.tree_height - 1,
                           mpfss_pre0.tree_n);
 
@@ -179,32 +779,41 @@ public:
     ot_consumed += M_pre0;
 
     // Using direct mock VOLE - no COPE/OTCO, no OpenSSL dependency
-    Base_svole_direct_mock<IO> *svole0;
-    int triple_n0 = 1 + mpfss_pre0.tree_n + param.k_pre0;
+    int triple_n0 = kMpfssCheckMasks + mpfss_pre0.tree_n + param.k_pre0;
     if (party == ALICE) {
-      __uint128_t *key = new __uint128_t[triple_n0];
-      svole0 = new Base_svole_direct_mock<IO>(party, ios[0], Delta);
-      svole0->triple_gen_send(key, triple_n0);
+      std::vector<__uint128_t> key(triple_n0);
+      Base_svole_direct_mock<IO> svole0(party, ios[0], Delta);
+      svole0.triple_gen_send(key.data(), triple_n0);
 
-      extend_send(pre_yz0, &mpfss_pre0, &pre_ot_ini0, &lpn_pre0, key);
-      delete[] key;
+      extend_send(pre_yz0, &mpfss_pre0, &pre_ot_ini0, &lpn_pre0, key.data());
     } else {
-      __uint128_t *mac = new __uint128_t[triple_n0];
-      svole0 = new Base_svole_direct_mock<IO>(party, ios[0]);
-      svole0->triple_gen_recv(mac, triple_n0);
+      std::vector<__uint128_t> mac(triple_n0);
+      Base_svole_direct_mock<IO> svole0(party, ios[0]);
+      svole0.triple_gen_recv(mac.data(), triple_n0);
+
+      extend_recv(pre_yz0, &mpfss_pre0, &pre_ot_ini0, &lpn_pre0, mac.data());
+    }
 
-      extend_recv(pre_yz0, &mpfss_pre0, &pre_ot_ini0, &lpn_pre0, mac);
-      delete[] mac;
+    if (dual_ea) {
+      // The EA final stage consumes only t + kMpfssCheckMasks of stage 0's
+      // outputs a round
+      pre_yz = yz0.release();
+      pre_ot_inplace = true;
+      fut.get();
+      return;
     }
-    delete svole0;
 
-    pre_yz = new __uint128_t[param.n_pre];
+    stage_span.next("stage1", param.n_pre);
+    pre_yz = vole_alloc_array<__uint128_t>(param.n_pre);
     memset(pre_yz, 0, param.n_pre * sizeof(__uint128_t));
 
-    LpnFpBlake3<10> lpn_pre(param.n_pre, param.k_pre, pool, pool->size());
-    MpfssRegFpBlake3<IO> mpfss_pre(party, threads, param.n_pre, param.t_pre,
-                                   param.log_bin_sz_pre, pool, ios);
+    LpnFpBlake3<10, PreStage> lpn_pre(param.n_pre, param.k_pre, pool,
+                                      pool->size());
+    MpfssRegFpBlake3<IO, PreStage, Prp> mpfss_pre(
+        party, threads, param.n_pre, param.t_pre, param.log_bin_sz_pre, pool,
+        ios);
     mpfss_pre.set_malicious();
+    seed_mpfss(&mpfss_pre, 1);
     OTPre<IO> pre_ot_ini(ios[0], mpfss_pre.tree_height - 1, mpfss_pre.tree_n);
 
     int M_pre = pre_ot_ini.n;
@@ -218,26 +827,123 @@ public:
     }
     pre_ot_inplace = true;
 
-    delete[] pre_yz0;
+    if (compact_sender) {
+      pre_y64 = vole_alloc_array<uint64_t>(param.n_pre);
+      for (int64_t i = 0; i < param.n_pre; ++i)
+        pre_y64[i] = (uint64_t)pre_yz[i];
+      vole_free(pre_yz);
+      pre_yz = nullptr;
+    }
+    if (soa_receiver) {
+      pre_x64 = vole_alloc_array<uint64_t>(param.n_pre);
+      pre_z64 = vole_alloc_array<uint64_t>(param.n_pre);
+      for (int64_t i = 0; i < param.n_pre; ++i) {
+        pre_x64[i] = (uint64_t)(pre_yz[i] >> 64);
+        pre_z64[i] = (uint64_t)pre_yz[i];
+      }
+      vole_free(pre_yz);
+      pre_yz = nullptr;
+    }
 
     fut.get();
   }
 
-  void extend(__uint128_t *data_yz, int num) {
-    if (vole_triples == nullptr) {
-      vole_triples = new __uint128_t[param.n];
+  void extend(__uint128_t *data_yz, int num) { extend_n(data_yz, num, vole_triples); }
+
+  void extend(uint64_t *data_y, int num) { extend_n(data_y, num, vole_y64); }
+
+  // Split receiver: num x words into data_x and num z words into data_z
+  void extend(uint64_t *data_x, uint64_t *data_z, int num) {
+    if (vole_x64 == nullptr) {
+      vole_x64 = vole_alloc_array<uint64_t>(param.n);
+      vole_z64 = vole_alloc_array<uint64_t>(param.n);
+    }
+    extend_rounds(
+        num, [&](int64_t at) { extend(data_x + at, data_z + at); },
+        [&]() { extend(vole_x64, vole_z64); },
+        [&](int64_t at, int from, int cnt) {
+          memcpy(data_x + at, vole_x64 + from, cnt * sizeof(uint64_t));
+          memcpy(data_z + at, vole_z64 + from, cnt * sizeof(uint64_t));
+          count_copy(2 * (int64_t)cnt * sizeof(uint64_t));
+        });
+  }
+
+  // num outputs into data_yz; the rest of a round waits in round_buf
+  // (vole_triples, or vole_y64 for a compact sender)
+  template <typename T> void extend_n(T *data_yz, int num, T *&round_buf) {
+    if (round_buf == nullptr) {
+      round_buf = vole_alloc_array<T>(param.n);
     }
+    T *buf = round_buf;
+    extend_rounds(
+        num, [&](int64_t at) { extend(data_yz + at); },
+        [&]() { extend(buf); },
+        [&](int64_t at, int from, int cnt) {
+          memcpy(data_yz + at, buf + from, cnt * sizeof(T));
+          count_copy((int64_t)cnt * sizeof(T));
+        });
+  }
+
+  // Elements of a caller buffer for extend_inplace(buf, num): num outputs,
+  // fewer than one round of outputs kept from the previous call and the M
+  // outputs the last round writes past its own. Requests of whole rounds
+  // never write the extra round, so its pages are never touched.
+  int64_t inplace_capacity(int64_t num) const { return num + ot_limit + M; }
+
+  // num outputs generated straight into buf, without the round buffer;
+  // returns where they start. buf holds inplace_capacity(num) elements and
+  // is the same buffer on every call. Round i fills buf[i * ot_limit, ...)
+  // behind the outputs kept from the last call and overwrites the carry of
+  // round i - 1. The last round's outputs past num stay in buf, counted by
+  // ot_used, and serve the next call: in place if they cover it, otherwise
+  // moved to the front of buf first. Outputs buffered by extend(data, num)
+  // must be used up before switching to it.
+  template <typename T> T *extend_inplace(T *buf, int64_t num) {
+    if (extend_initialized == false)
+      error("Run setup before extending");
+    int64_t left = silent_ot_left();
+    if (left > 0 && inplace_buf != (void *)buf)
+      error("extend_inplace continues in the buffer holding its kept outputs");
+    if (num <= left) {
+      T *out = buf + inplace_at;
+      inplace_at += num;
+      ot_used += (int)num;
+      return out;
+    }
+    if (left > 0) {
+      memmove(buf, buf + inplace_at, left * sizeof(T));
+      count_copy(left * sizeof(T));
+    }
+    int64_t at = left;
+    for (; at < num; at += ot_limit)
+      extend(buf + at);
+    ot_used = ot_limit - (int)(at - num);
+    inplace_buf = buf;
+    inplace_at = num;
+    return buf;
+  }
+
+  // Hands out num outputs whatever the storage: round_out(at) extends a
+  // whole round straight into the output at offset at, round_buf() extends
+  // into the round buffer and copy(at, from, cnt) moves cnt buffered
+  // outputs from offset from to the output
+  template <typename RoundOut, typename RoundBuf, typename Copy>
+  void extend_rounds(int num, RoundOut round_out, RoundBuf round_buf,
+                     Copy copy) {
     if (extend_initialized == false)
       error("Run setup before extending");
+    if (inplace_buf != nullptr && silent_ot_left() > 0)
+      error("Use up the outputs kept by extend_inplace first");
+    inplace_buf = nullptr;
     if (num <= silent_ot_left()) {
-      memcpy(data_yz, vole_triples + ot_used, num * sizeof(__uint128_t));
+      copy(0, ot_used, num);
       this->ot_used += num;
       return;
     }
-    __uint128_t *pt = data_yz;
+    int64_t pt = 0;
     int gened = silent_ot_left();
     if (gened > 0) {
-      memcpy(pt, vole_triples + ot_used, gened * sizeof(__uint128_t));
+      copy(pt, ot_used, gened);
       pt += gened;
     }
     int round_inplace = (num - gened - M) / ot_limit;
@@ -246,31 +952,81 @@ public:
     if (round_memcpy)
       last_round_ot -= ot_limit;
     for (int i = 0; i < round_inplace; ++i) {
-      extend(pt);
+      round_out(pt);
       ot_used = ot_limit;
       pt += ot_limit;
     }
     if (round_memcpy) {
-      extend(vole_triples);
-      memcpy(pt, vole_triples, ot_limit * sizeof(__uint128_t));
+      round_buf();
+      copy(pt, 0, ot_limit);
       ot_used = ot_limit;
       pt += ot_limit;
     }
     if (last_round_ot > 0) {
-      extend(vole_triples);
-      memcpy(pt, vole_triples, last_round_ot * sizeof(__uint128_t));
+      round_buf();
+      copy(pt, 0, last_round_ot);
       ot_used = last_round_ot;
     }
   }
 
+  template <typename P = Param>
+  static typename std::enable_if<P::fixed, PrimalLPNParameterFp61Blake3>::type
+  default_param() {
+    return P::runtime();
+  }
+  template <typename P = Param>
+  static typename std::enable_if<!P::fixed, PrimalLPNParameterFp61Blake3>::type
+  default_param() {
+    return fp_default_blake3;
+  }
+
+  static PrimalLPNParameterFp61Blake3 profile_param(const char *profile) {
+    PrimalLPNParameterFp61Blake3 p;
+    if (!lpn_param_lookup_fp61(profile, &p))
+      error("Unknown LPN parameter profile");
+    return p;
+  }
+
   int silent_ot_left() { return ot_limit - ot_used; }
 
+  // Bytes of outputs copied after generation (the carried pre-VOLEs,
+  // buffered outputs), charged to extend_stats
+  void count_copy(int64_t bytes) {
+    extend_stats.count[VOLE_COUNT_COPY_BYTES] += bytes;
+  }
+
   // Get total OTs consumed by the protocol
   int64_t get_ot_consumed() { return ot_consumed; }
 
+  void print_stats() const {
+    setup_stats.print("Setup phases");
+    extend_stats.print("Extend phases");
+  }
+
+  // {"setup":{...},"extend":{...}}, each as VoleStats::json
+  std::string stats_json() const {
+    return "{\"setup\":" + setup_stats.json() +
+           ",\"extend\":" + extend_stats.json() + "}";
+  }
+
+  // BOB's side of check_triple for split x and z words
+  void check_triple(__uint128_t, const uint64_t *x, const uint64_t *z,
+                    int size) {
+    if (party == ALICE)
+      error("Only the receiver has split x/z outputs");
+    check_recv([x, z](int i) { return ((__uint128_t)x[i] << 64) | z[i]; },
+               size);
+  }
+
+  // ALICE's side of check_triple for a compact sender's y values
+  void check_triple(__uint128_t delta_in, const uint64_t *data, int size) {
+    std::vector<__uint128_t> wide(data, data + size);
+    check_triple(delta_in, wide.data(), size);
+  }
+
   // Verify VOLE correlation: z = x * Delta + y
   // Alice sends Delta + hash(y), Bob verifies locally
-  void check_triple(__uint128_t delta_in, __uint128_t *data, int size) {
+  void check_triple(__uint128_t delta_in, const __uint128_t *data, int size) {
     Hash hash;
     if (party == ALICE) {
       // Send Delta
@@ -280,34 +1036,41 @@ public:
       io->send_data(&h, sizeof(block));
       io->flush();
     } else {
-      // Receive Delta
-      __uint128_t delta;
-      io->recv_data(&delta, sizeof(__uint128_t));
-      // Receive expected hash
-      block expected_hash;
-      io->recv_data(&expected_hash, sizeof(block));
-
-      // Compute y values locally: y = z - x * Delta
-      __uint128_t *computed_y = new __uint128_t[size];
-      for (int i = 0; i < size; ++i) {
-        uint64_t x = data[i] >> 64;
-        uint64_t z = data[i] & 0xFFFFFFFFFFFFFFFFULL;
-        uint64_t x_delta = mult_mod(x, (uint64_t)delta);
-        uint64_t y = (z >= x_delta) ? (z - x_delta) : (pr - x_delta + z);
-        y = mod(y);
-        computed_y[i] = y;
-      }
+      check_recv([data](int i) { return data[i]; }, size);
+    }
+  }
 
-      // Hash computed y values and compare
-      block computed_hash = hash.hash_for_block(computed_y, size * sizeof(__uint128_t));
-      delete[] computed_y;
+  // BOB's check over size outputs; xz(i) is output i as (x << 64) | z
+  template <typename XZ> void check_recv(XZ xz, int size) {
+    Hash hash;
+    // Receive Delta
+    __uint128_t delta;
+    io->recv_data(&delta, sizeof(__uint128_t));
+    // Receive expected hash
+    block expected_hash;
+    io->recv_data(&expected_hash, sizeof(block));
 
-      if (cmpBlock(&computed_hash, &expected_hash, 1)) {
-        std::cout << "Verification PASSED: all " << size << " correlations correct" << std::endl;
-      } else {
-        std::cout << "Verification FAILED: hash mismatch" << std::endl;
-        abort();
-      }
+    // Compute y values locally: y = z - x * Delta
+    __uint128_t *computed_y = new __uint128_t[size];
+    for (int i = 0; i < size; ++i) {
+      __uint128_t v = xz(i);
+      uint64_t x = v >> 64;
+      uint64_t z = v & 0xFFFFFFFFFFFFFFFFULL;
+      uint64_t x_delta = mult_mod(x, (uint64_t)delta);
+      uint64_t y = (z >= x_delta) ? (z - x_delta) : (pr - x_delta + z);
+      y = mod(y);
+      computed_y[i] = y;
+    }
+
+    // Hash computed y values and compare
+    block computed_hash = hash.hash_for_block(computed_y, size * sizeof(__uint128_t));
+    delete[] computed_y;
+
+    if (cmpBlock(&computed_hash, &expected_hash, 1)) {
+      std::cout << "Verification PASSED: all " << size << " correlations correct" << std::endl;
+    } else {
+      std::cout << "Verification FAILED: hash mismatch" << std::endl;
+      abort();
     }
   }
 };
@@ -0,0 +1,91 @@
+// Counts heap allocations into the calling thread's VoleStats
+// (VOLE_COUNT_ALLOCS) by replacing the global operator new/delete with
+// malloc/free. Linked only into the profiling tools (vole_loopback,
+// vole_microbench); the shipped sender, receiver and wasm module keep the
+// library allocator. Compiled out, like the other instrumentation, by
+// -DVOLE_NO_STATS.
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "../emp-zk/emp-vole/vole_stats.h"
+
+#ifndef VOLE_NO_STATS
+
+static void *counted_alloc(std::size_t size, std::size_t align) {
+  VOLE_COUNT(VOLE_COUNT_ALLOCS, 1);
+  if (size == 0)
+    size = 1;
+  void *p = nullptr;
+  if (align <= alignof(std::max_align_t))
+    p = std::malloc(size);
+  else if (posix_memalign(&p, align, size) != 0)
+    p = nullptr;
+  return p;
+}
+
+static void *counted_new(std::size_t size, std::size_t align) {
+  void *p = counted_alloc(size, align);
+  if (p == nullptr) {
+    fprintf(stderr, "Error: out of memory\n");
+    abort();
+  }
+  return p;
+}
+
+void *operator new(std::size_t size) { return counted_new(size, 0); }
+void *operator new[](std::size_t size) { return counted_new(size, 0); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, 0);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size, 0);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned types go through these under C++17; posix_memalign memory is
+// released with free, like the rest
+void *operator new(std::size_t size, std::align_val_t al) {
+  return counted_new(size, (std::size_t)al);
+}
+void *operator new[](std::size_t size, std::align_val_t al) {
+  return counted_new(size, (std::size_t)al);
+}
+void *operator new(std::size_t size, std::align_val_t al,
+                   const std::nothrow_t &) noexcept {
+  return counted_alloc(size, (std::size_t)al);
+}
+void *operator new[](std::size_t size, std::align_val_t al,
+                     const std::nothrow_t &) noexcept {
+  return counted_alloc(size, (std::size_t)al);
+}
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+#endif // __cpp_aligned_new
+
+#endif // VOLE_NO_STATS
@@ -0,0 +1,581 @@
+// VOLE sender and receiver in one process over LocalIO
+// ALICE runs on a second thread; no sockets, so profiles show only compute
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../emp-zk/emp-vole/emp-vole-portable.h"
+#include "../emp-zk/emp-vole/local_io.h"
+#include "../emp-zk/emp-vole/sim_io.h"
+#include "../emp-zk/emp-vole/vole_chunk_pool.h"
+#include "../emp-zk/emp-vole/vole_ring.h"
+
+using namespace emp;
+
+// Peak resident set size of this process in MB
+static double peak_rss_mb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss / 1024.0;
+}
+
+static long long minor_faults() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+// dTLB load misses of this thread and of the threads it starts afterwards
+// (counted once they exit), where the kernel exposes hardware cache
+// counters; many VMs do not
+struct TlbMissCounter {
+    int fd = -1;
+
+    TlbMissCounter() {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~TlbMissCounter() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    // -1 without a counter
+    long long count() const {
+        long long n;
+        if (fd < 0 || read(fd, &n, sizeof(n)) != sizeof(n))
+            return -1;
+        return n;
+    }
+};
+
+struct PartyTimes {
+    double setup_ms = 0;
+    double extend_ms = 0;
+    double first_round_ms = 0; // whole-round extends only
+    int64_t rounds_extended = 0; // rounds actually run, whatever --take asks
+    int64_t setup_trips = 0;
+    int64_t extend_trips = 0;
+    VoleStats setup_stats, extend_stats, prefetch_stats;
+    // Bytes sent after the constructor and at the end of each step (setup,
+    // then each round), and the recoveries (--faults)
+    size_t ctor_bytes = 0;
+    std::vector<size_t> step_bytes;
+    VoleResumeStats resume_stats;
+};
+
+// Party clock: wall time over LocalIO, simulated time over SimIO
+static double party_ms(LocalIO*) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+template <typename IO> static double party_ms(SimIO<IO>* io) { return io->now_ms(); }
+
+static int64_t party_round_trips(LocalIO*) { return 0; }
+template <typename IO> static int64_t party_round_trips(SimIO<IO>* io) { return io->round_trips; }
+
+// Set by --fs: both parties use Fiat-Shamir MPFSS checks
+static bool fiat_shamir = false;
+// Set by --ea: dual-LPN final stage with expand-accumulate compression
+static bool dual_ea = false;
+// Set by --compact: ALICE keeps its outputs as packed 64-bit words
+static bool compact_sender = false;
+// Set by --soa: BOB keeps its x and z words in two arrays
+static bool soa_receiver = false;
+// Set by --pipeline: next-round COTs and choices overlap each round's LPN
+static bool pipeline = false;
+// Set by --take: outputs are handed out in requests of this many VOLEs
+// through take_api instead of extending whole rounds
+static int64_t take_chunk = 0;
+enum TakeApi { TAKE_COPY, TAKE_INPLACE, TAKE_RING, TAKE_POOL };
+static TakeApi take_api = TAKE_COPY;
+// Set by --faults: both parties are resumable, and run_both drops the
+// connection after fault_gaps[0] bytes, then fault_gaps[i] bytes after
+// the i-th reconnect; fault_drops counts the drops
+static bool resumable = false;
+static std::vector<int64_t> fault_gaps;
+static int64_t fault_drops = 0;
+
+// --take: the rounds' outputs in take_chunk-sized requests, through
+// extend(data, num) copying out of the round buffer, extend_inplace into
+// a caller buffer, views of a VoleRing or, on Bob's side, leases of a
+// VoleChunkPool as the wasm session makes them, then the check of the last
+// request
+template <typename VoleT>
+static void take_outputs(VoleT& vole, int party, int rounds, bool check) {
+    int64_t total = rounds * (int64_t)vole.ot_limit;
+    int64_t last = total - (total - 1) / take_chunk * take_chunk;
+    if (take_api == TAKE_POOL && party == BOB) {
+        VoleChunkPool<VoleT> pool(&vole);
+        int id = -1;
+        for (int64_t at = 0; at < total; at += take_chunk) {
+            pool.release(id);
+            id = pool.lease(std::min(take_chunk, total - at));
+        }
+        if (check)
+            vole.check_triple(0, pool.x(id), pool.z(id), (int)last);
+        return;
+    }
+    VoleBuffer<__uint128_t> out;
+    VoleRing<VoleT> *ring = nullptr;
+    if (take_api == TAKE_RING)
+        ring = new VoleRing<VoleT>(&vole, take_chunk);
+    else
+        out.resize(take_api == TAKE_INPLACE ? vole.inplace_capacity(take_chunk)
+                                            : take_chunk);
+    const __uint128_t* view = nullptr;
+    for (int64_t at = 0; at < total; at += take_chunk) {
+        int64_t num = std::min(take_chunk, total - at);
+        if (take_api == TAKE_RING) {
+            view = ring->next(num);
+        } else {
+            if (take_api == TAKE_INPLACE) {
+                view = vole.extend_inplace(out.data(), num);
+            } else {
+                vole.extend(out.data(), (int)num);
+                view = out.data();
+            }
+        }
+    }
+    if (check)
+        vole.check_triple(party == ALICE ? vole.delta() : 0, view, (int)last);
+    delete ring;
+}
+
+// One party: setup, `rounds` extends into one output buffer, then the
+// correlation check
+// unless check is false. Param selects the runtime or the compile-time
+// parameter path, Prp the GGM tree expansion.
+template <typename Param, typename Prp, typename IO>
+static void run_party(int party, IO* io, const char* profile, int rounds,
+                      PartyTimes& times, bool check) {
+    typedef VoleTripleBlake3<IO, Param, Prp> VoleT;
+    IO* ios[1] = {io};
+    double start = party_ms(io);
+    VoleT vole(party, 1, ios, VoleT::profile_param(profile));
+    times.ctor_bytes = io->bytes_sent;
+    if (resumable)
+        vole.set_resumable();
+    if (fiat_shamir)
+        vole.set_fiat_shamir();
+    if (dual_ea)
+        vole.set_dual_ea();
+    bool compact = party == ALICE && compact_sender;
+    if (compact)
+        vole.set_compact_sender();
+    bool soa = party == BOB && (soa_receiver || take_api == TAKE_POOL);
+    if (soa)
+        vole.set_soa_receiver();
+    if (pipeline)
+        vole.set_pipeline();
+    vole.setup();
+    double mid = party_ms(io);
+    times.setup_ms = mid - start;
+    times.setup_trips = party_round_trips(io);
+    times.step_bytes.push_back(io->bytes_sent);
+
+    if (take_chunk > 0) {
+        take_outputs(vole, party, rounds, check);
+        times.extend_ms = party_ms(io) - mid;
+        times.rounds_extended = vole.rounds_extended;
+        times.extend_trips = party_round_trips(io) - times.setup_trips;
+        times.setup_stats = vole.setup_stats;
+        times.extend_stats = vole.extend_stats;
+        times.prefetch_stats = vole.prefetch_stats;
+        return;
+    }
+
+    VoleBuffer<__uint128_t> out;
+    VoleBuffer<uint64_t> out64, out_z;
+    if (compact || soa)
+        out64.resize(vole.param.n);
+    if (soa)
+        out_z.resize(vole.param.n);
+    if (!compact && !soa)
+        out.resize(vole.param.n);
+    for (int i = 0; i < rounds; ++i) {
+        if (compact)
+            vole.extend(out64.data());
+        else if (soa)
+            vole.extend(out64.data(), out_z.data());
+        else
+            vole.extend(out.data());
+        if (i == 0)
+            times.first_round_ms = party_ms(io) - mid;
+        times.step_bytes.push_back(io->bytes_sent);
+    }
+    vole.finish();
+    times.extend_ms = party_ms(io) - mid;
+    times.extend_trips = party_round_trips(io) - times.setup_trips;
+    times.rounds_extended = vole.rounds_extended;
+    times.setup_stats = vole.setup_stats;
+    times.extend_stats = vole.extend_stats;
+    times.prefetch_stats = vole.prefetch_stats;
+    times.resume_stats = vole.resume_stats;
+
+    if (!check)
+        return;
+    int64_t check_n = vole.param.buf_sz();
+    if (compact)
+        vole.check_triple(vole.delta(), out64.data(), check_n);
+    else if (soa)
+        vole.check_triple(0, out64.data(), out_z.data(), check_n);
+    else
+        vole.check_triple(party == ALICE ? vole.delta() : 0, out.data(), check_n);
+}
+
+// Runs both parties; with net != nullptr the traffic goes through SimIO
+template <typename Param, typename Prp = TwoKeyPRP_Blake3>
+static void run_both(const char* profile, int rounds, const SimNetConfig* net,
+                     PartyTimes& alice_t, PartyTimes& bob_t,
+                     size_t& bob_sent, size_t& alice_sent, bool check = true) {
+    LocalChannel channel;
+    LocalIO alice_io(&channel, ALICE), bob_io(&channel, BOB);
+    size_t next_fault = 0;
+    if (!fault_gaps.empty()) {
+        channel.on_reconnect = [&]() {
+            if (++next_fault < fault_gaps.size())
+                channel.drop_after(fault_gaps[next_fault]);
+        };
+        channel.drop_after(fault_gaps[0]);
+    }
+
+    if (net == nullptr) {
+        std::thread alice([&]() {
+            run_party<Param, Prp>(ALICE, &alice_io, profile, rounds, alice_t, check);
+        });
+        run_party<Param, Prp>(BOB, &bob_io, profile, rounds, bob_t, check);
+        alice.join();
+    } else {
+        SimLink link(*net);
+        SimIO<LocalIO> alice_sim(&alice_io, &link, ALICE), bob_sim(&bob_io, &link, BOB);
+        std::thread alice([&]() {
+            run_party<Param, Prp>(ALICE, &alice_sim, profile, rounds, alice_t, check);
+        });
+        run_party<Param, Prp>(BOB, &bob_sim, profile, rounds, bob_t, check);
+        alice.join();
+    }
+    bob_sent = bob_io.bytes_sent;
+    alice_sent = alice_io.bytes_sent;
+    fault_drops = channel.drops;
+}
+
+// --faults: a clean resumable run, then one that drops the connection
+// `faults` times. The first drop loses the last send of a random step, the
+// last round included, so the receiving party falls one step behind and
+// its peer replays that step (from the closing step after the last round).
+// The others fall at random points of the clean run's traffic up to the end
+// of the last round, or of the rerun last round if the first drop ends it.
+template <typename Param, typename Prp = TwoKeyPRP_Blake3>
+static void run_faults(const char* profile, int rounds, int faults, uint64_t seed) {
+    PartyTimes clean_a, clean_b, alice_t, bob_t;
+    size_t bob_sent, alice_sent;
+    run_both<Param, Prp>(profile, rounds, nullptr, clean_a, clean_b, bob_sent, alice_sent);
+    size_t clean_bytes = bob_sent + alice_sent;
+
+    // Both parties' bytes at the end of step s (setup is step 0, round i
+    // step i)
+    auto step_end = [&](int s) {
+        if (s < 0)
+            return (int64_t)(clean_a.ctor_bytes + clean_b.ctor_bytes);
+        return (int64_t)(clean_a.step_bytes[s] + clean_b.step_bytes[s]);
+    };
+    std::mt19937_64 rng(seed);
+    int first = (int)(rng() % (uint64_t)(rounds + 1));
+    fault_gaps.push_back(step_end(first) - 1);
+    if (faults > 1) {
+        int64_t span = first < rounds ? step_end(rounds) - step_end(first)
+                                      : step_end(rounds) - step_end(rounds - 1);
+        span /= faults - 1;
+        if (span < 1)
+            error("Too many faults for this run");
+        for (int i = 1; i < faults; ++i)
+            fault_gaps.push_back(1 + (int64_t)(rng() % (uint64_t)span));
+    }
+    run_both<Param, Prp>(profile, rounds, nullptr, alice_t, bob_t, bob_sent, alice_sent);
+    fault_gaps.clear();
+
+    const VoleResumeStats& ra = alice_t.resume_stats;
+    const VoleResumeStats& rb = bob_t.resume_stats;
+    int64_t recoveries = ra.drops + rb.drops;
+    double clean_ms = clean_b.setup_ms + clean_b.extend_ms;
+    double faulty_ms = bob_t.setup_ms + bob_t.extend_ms;
+    printf("\n========================================\n");
+    printf("Fault injection (%d drop%s, seed %llu)\n", faults, faults > 1 ? "s" : "",
+           (unsigned long long)seed);
+    printf("========================================\n");
+    printf("Drops injected:  %lld\n", (long long)fault_drops);
+    printf("First drop:      last send of %s\n",
+           first == 0 ? "setup" : first == rounds ? "the last round" : "a middle round");
+    printf("Reconnects:      alice %lld, bob %lld\n", (long long)ra.drops,
+           (long long)rb.drops);
+    printf("Steps replayed:  alice %lld, bob %lld\n", (long long)ra.replays,
+           (long long)rb.replays);
+    printf("Recovery time:   mean %.2f ms, max %.2f ms (%.0f ms of it replays)\n",
+           (ra.recover_ms + rb.recover_ms) / std::max(recoveries, (int64_t)1),
+           std::max(ra.recover_max_ms, rb.recover_max_ms), ra.replay_ms + rb.replay_ms);
+    printf("Session time:    %.0f ms clean, %.0f ms with drops (bob, %+.1f%%)\n", clean_ms,
+           faulty_ms, 100.0 * (faulty_ms - clean_ms) / std::max(clean_ms, 1.0));
+    printf("Traffic:         %zu bytes clean, %zu bytes with drops\n", clean_bytes,
+           bob_sent + alice_sent);
+    printf("========================================\n");
+    if (fault_drops != faults)
+        error("Not every fault was injected");
+}
+
+template <typename Param, typename Prp = TwoKeyPRP_Blake3>
+static void run_protocol(const char* profile, int rounds, const SimNetConfig* net) {
+    typedef VoleTripleBlake3<LocalIO, Param> VoleT;
+    PartyTimes alice_t, bob_t;
+    size_t bob_sent, alice_sent;
+    TlbMissCounter tlb;
+    long long faults = minor_faults();
+    run_both<Param, Prp>(profile, rounds, net, alice_t, bob_t, bob_sent, alice_sent);
+    faults = minor_faults() - faults;
+    long long tlb_misses = tlb.count();
+    VoleArenaStats arena = vole_arena().stats();
+
+    PrimalLPNParameterFp61Blake3 prm = VoleT::profile_param(profile);
+    if (dual_ea)
+        prm = ea_param_fp61(prm);
+    int64_t extended = bob_t.rounds_extended;
+    int64_t output_size = prm.buf_sz() * extended;
+    printf("\n========================================\n");
+    printf("Results (%lld extend round%s%s)\n", (long long)extended, extended > 1 ? "s" : "",
+           net ? ", simulated network" : "");
+    printf("========================================\n");
+    printf("Setup time:      alice %.0f ms, bob %.0f ms\n", alice_t.setup_ms, bob_t.setup_ms);
+    printf("Extension time:  alice %.0f ms, bob %.0f ms\n", alice_t.extend_ms, bob_t.extend_ms);
+    printf("VOLEs generated: %lld\n", (long long)output_size);
+    printf("Extend rate:     %.2f million VOLEs/sec\n",
+           (double)output_size / (std::max(bob_t.extend_ms, 1.0) / 1000.0) / 1e6);
+    if (rounds > 1 && bob_t.first_round_ms > 0)
+        printf("Sustained rate:  %.2f million VOLEs/sec (rounds 2-%d)\n",
+               (double)prm.buf_sz() * (rounds - 1) /
+                   (std::max(bob_t.extend_ms - bob_t.first_round_ms, 1.0) / 1000.0) / 1e6,
+               rounds);
+    if (net)
+        printf("Round trips:     setup %lld, extend %lld (bob)\n",
+               (long long)bob_t.setup_trips, (long long)bob_t.extend_trips);
+    printf("Peak memory:     %.1f MB (both parties)\n", peak_rss_mb());
+    VoleLayoutFp61 alice_l, bob_l;
+    alice_l.party = ALICE;
+    alice_l.compact_sender = compact_sender;
+    bob_l.soa_receiver = soa_receiver;
+    alice_l.dual_ea = bob_l.dual_ea = dual_ea;
+    alice_l.round_buffer = bob_l.round_buffer = take_chunk > 0 && take_api == TAKE_COPY;
+    printf("Modelled memory: alice %.1f MB, bob %.1f MB (lpn_memory_fp61)\n",
+           lpn_memory_fp61(prm, alice_l) / 1048576.0, lpn_memory_fp61(prm, bob_l) / 1048576.0);
+    printf("Copied outputs:  %.1f MB (bob)\n",
+           bob_t.extend_stats.count[VOLE_COUNT_COPY_BYTES] / 1048576.0);
+    printf("Huge pages:      %s (%lld mappings, %lld reused)\n",
+           vole_huge_pages_name(vole_arena().mode), (long long)arena.maps,
+           (long long)arena.reuses);
+    printf("Page faults:     %lld minor\n", faults);
+    if (tlb_misses >= 0)
+        printf("dTLB misses:     %lld\n", tlb_misses);
+    else
+        printf("dTLB misses:     n/a (no hardware counters)\n");
+    printf("========================================\n");
+    printf("Bob -> Alice: %zu bytes, Alice -> Bob: %zu bytes\n", bob_sent, alice_sent);
+    printf("\n--- Phases (bob) ---\n");
+    bob_t.setup_stats.print("Setup phases");
+    bob_t.extend_stats.print("Extend phases");
+    if (pipeline)
+        bob_t.prefetch_stats.print("Prefetch phases (second thread)");
+}
+
+// Simulated setup/extend time over a grid of RTTs and bandwidths
+static void run_sweep(const std::vector<const char*>& profiles) {
+    const double rtts[] = {0, 20, 50, 100};
+    const double bw[][2] = {{1000, 1000}, {50, 10}, {10, 2}}; // down, up
+    printf("\n%-8s %7s %11s %10s %11s %7s\n", "profile", "rtt_ms", "down/up", "setup_ms",
+           "extend_ms", "trips");
+    for (const char* profile : profiles) {
+        for (const auto& b : bw) {
+            for (double rtt : rtts) {
+                SimNetConfig net;
+                net.rtt_ms = rtt;
+                net.down_mbps = b[0];
+                net.up_mbps = b[1];
+                PartyTimes alice_t, bob_t;
+                size_t bob_sent, alice_sent;
+                run_both<LpnParamDynamic>(profile, 1, &net, alice_t, bob_t, bob_sent,
+                                          alice_sent, false);
+                char bw_str[32];
+                snprintf(bw_str, sizeof(bw_str), "%g/%g", b[0], b[1]);
+                char trips[32];
+                snprintf(trips, sizeof(trips), "%lld/%lld", (long long)bob_t.setup_trips,
+                         (long long)bob_t.extend_trips);
+                printf("%-8s %7g %11s %10.0f %11.0f %7s\n", profile, rtt, bw_str,
+                       bob_t.setup_ms, bob_t.extend_ms, trips);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    // --fixed selects the compile-time specialised pipeline, --net
+    // RTT:DOWN:UP[:JITTER] (ms, Mbit/s) simulates a network, --sweep runs a
+    // grid of them ("all" as the profile sweeps every profile), --trace FILE
+    // writes both parties' timelines into one Chrome trace, --fs selects
+    // Fiat-Shamir MPFSS checks, --half-tree the one-hash-per-node GGM trees,
+    // --ea the expand-accumulate dual-LPN final stage (both runtime
+    // parameters only), --compact packed 64-bit sender outputs, --soa
+    // separate receiver x and z arrays, --take CHUNK[:copy|inplace|ring|pool]
+    // hands the outputs out in CHUNK-sized requests through the given API,
+    // --pipeline overlaps each round's LPN with the next round's COTs,
+    // --faults N[:SEED] drops the connection N times in a resumable session
+    bool fixed = false, sweep = false, half_tree = false;
+    const char* trace_path = nullptr;
+    SimNetConfig net;
+    bool use_net = false;
+    int faults = 0;
+    unsigned long long fault_seed = std::random_device()();
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fixed") == 0) {
+            fixed = true;
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            sweep = true;
+        } else if (strcmp(argv[i], "--fs") == 0) {
+            fiat_shamir = true;
+        } else if (strcmp(argv[i], "--half-tree") == 0) {
+            half_tree = true;
+        } else if (strcmp(argv[i], "--ea") == 0) {
+            dual_ea = true;
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            compact_sender = true;
+        } else if (strcmp(argv[i], "--soa") == 0) {
+            soa_receiver = true;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = true;
+        } else if (strcmp(argv[i], "--take") == 0 && i + 1 < argc) {
+            char api[16] = "copy";
+            long long chunk = 0;
+            if (sscanf(argv[++i], "%lld:%15s", &chunk, api) < 1 || chunk <= 0)
+                error("--take expects CHUNK[:copy|inplace|ring|pool]");
+            take_chunk = chunk;
+            if (strcmp(api, "inplace") == 0)
+                take_api = TAKE_INPLACE;
+            else if (strcmp(api, "ring") == 0)
+                take_api = TAKE_RING;
+            else if (strcmp(api, "pool") == 0)
+                take_api = TAKE_POOL;
+            else if (strcmp(api, "copy") != 0)
+                error("--take expects CHUNK[:copy|inplace|ring|pool]");
+        } else if (strcmp(argv[i], "--faults") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d:%llu", &faults, &fault_seed) < 1 || faults <= 0)
+                error("--faults expects N[:SEED]");
+            resumable = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--net") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lf:%lf:%lf:%lf", &net.rtt_ms, &net.down_mbps,
+                       &net.up_mbps, &net.jitter_ms) < 3)
+                error("--net expects RTT:DOWN:UP[:JITTER]");
+            use_net = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    const char* profile = "default";
+    int rounds = 1;
+    if (args.size() > 0) profile = args[0];
+    if (args.size() > 1) rounds = atoi(args[1]);
+    std::vector<const char*> profiles;
+    PrimalLPNParameterFp61Blake3 prm;
+    if (sweep && strcmp(profile, "all") == 0) {
+        for (int i = 0; i < fp_blake3_profile_n; ++i)
+            profiles.push_back(fp_blake3_profiles[i].name);
+    } else {
+        if (!lpn_param_lookup_fp61(profile, &prm))
+            error("Unknown LPN parameter profile");
+        profiles.push_back(profile);
+    }
+
+    printf("\n========================================\n");
+    printf("VOLE Loopback (Alice + Bob, LocalIO)\n");
+    printf("========================================\n\n");
+    printf("CPU dispatch: %s kernels, %d BLAKE3 lanes\n",
+           fp61_level_name(fp61_cpu_level()), blake3_batch_lanes());
+
+    if (resumable && (use_net || sweep || pipeline || take_chunk > 0))
+        error("--faults runs whole rounds over LocalIO, one at a time");
+    if (sweep) {
+        run_sweep(profiles);
+        return 0;
+    }
+
+    printf("Profile: %s (%s parameters%s%s%s%s%s%s)\n", profile,
+           fixed ? "compile-time" : "runtime", fiat_shamir ? ", Fiat-Shamir checks" : "",
+           half_tree ? ", half-tree GGM" : "", dual_ea ? ", dual-LPN EA" : "",
+           compact_sender ? ", 64-bit sender outputs" : "",
+           soa_receiver ? ", split receiver x/z" : "", pipeline ? ", pipelined" : "");
+    printf("LPN stages: n %lld t %lld k %lld, n_pre %lld t_pre %lld k_pre %lld, "
+           "n_pre0 %lld t_pre0 %lld k_pre0 %lld (%lld VOLEs a round)\n",
+           (long long)prm.n, (long long)prm.t, (long long)prm.k, (long long)prm.n_pre,
+           (long long)prm.t_pre, (long long)prm.k_pre, (long long)prm.n_pre0,
+           (long long)prm.t_pre0, (long long)prm.k_pre0, (long long)prm.buf_sz());
+    if (use_net)
+        printf("Network: RTT %g ms, down %g Mbit/s, up %g Mbit/s, jitter %g ms\n",
+               net.rtt_ms, net.down_mbps, net.up_mbps, net.jitter_ms);
+    const SimNetConfig* netp = use_net ? &net : nullptr;
+    if (trace_path != nullptr)
+        vole_trace_start();
+    if (take_chunk > 0 && (compact_sender || soa_receiver))
+        error("--take hands out 128-bit outputs only");
+    if (take_chunk > 0)
+        printf("Outputs taken in requests of %lld through %s\n", (long long)take_chunk,
+               take_api == TAKE_RING      ? "a VoleRing"
+               : take_api == TAKE_INPLACE ? "extend_inplace"
+               : take_api == TAKE_POOL    ? "a VoleChunkPool (bob), extend(data, num) (alice)"
+                                          : "extend(data, num)");
+    if (fixed && (half_tree || dual_ea))
+        error("--half-tree and --ea run with runtime parameters only");
+    if (resumable && fixed)
+        error("--faults runs with runtime parameters only");
+    if (resumable && half_tree) {
+        run_faults<LpnParamDynamic, HalfTreePRP_Blake3>(profile, rounds, faults, fault_seed);
+    } else if (resumable) {
+        run_faults<LpnParamDynamic>(profile, rounds, faults, fault_seed);
+    } else if (half_tree) {
+        run_protocol<LpnParamDynamic, HalfTreePRP_Blake3>(profile, rounds, netp);
+    } else if (fixed) {
+        if (!with_fixed_profile_fp61(profile, [&](auto p) {
+                run_protocol<decltype(p)>(profile, rounds, netp);
+            }))
+            error("No compile-time parameter set for this profile");
+    } else {
+        run_protocol<LpnParamDynamic>(profile, rounds, netp);
+    }
+    if (trace_path != nullptr) {
+        if (!vole_trace_dump(trace_path))
+            error("Cannot write trace file");
+        printf("Trace written to %s\n", trace_path);
+    }
+
+    printf("\n--- Mock Statistics (both parties) ---\n");
+    printf("Base COTs:   %lld\n", (long long)(BaseCotMock<LocalIO>::total_cots +
+                                            BaseCotMock<SimIO<LocalIO>>::total_cots));
+    printf("Base VOLEs:  %lld\n",
+           (long long)(Base_svole_direct_mock<LocalIO>::total_base_voles +
+                       Base_svole_direct_mock<SimIO<LocalIO>>::total_base_voles));
+
+    return 0;
+}
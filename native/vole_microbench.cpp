@@ -0,0 +1,404 @@
+// Microbenchmarks for the portable VOLE primitives
+// Builds natively and with Emscripten (run under Node); prints a table or
+// JSON and can compare against a checked-in baseline
+
+#include <cstdio>
+#include <chrono>
+#include <string>
+
+#include "../emp-zk/emp-vole/emp-vole-portable.h"
+
+using namespace emp;
+
+// Transport that folds sends into a checksum (so they are not optimized
+// away) and receives zeros; OTPre::send/recv and the SPFSS code run without
+// a peer
+struct NullIO {
+    uint64_t sink = 0;
+    void send_data(const void* data, int len) {
+        for (int i = 0; i + 8 <= len; i += 8) {
+            uint64_t w;
+            memcpy(&w, (const uint8_t*)data + i, 8);
+            sink ^= w;
+        }
+    }
+    void recv_data(void* data, int len) { memset(data, 0, len); }
+    void flush() {}
+};
+
+struct BenchResult {
+    std::string name;
+    double ns_per_op;
+    int64_t ops; // operations per call of the benchmark body
+};
+
+static double now_ns() {
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Best of five repetitions, each repeating body for at least min_ms / 5
+template <typename F>
+static BenchResult run_bench(const char* name, int64_t ops, double min_ms, F body) {
+    body(); // warm-up
+    double best = 1e300;
+    for (int rep = 0; rep < 5; ++rep) {
+        double start = now_ns(), elapsed;
+        int64_t calls = 0;
+        do {
+            body();
+            ++calls;
+            elapsed = now_ns() - start;
+        } while (elapsed < min_ms * 1e6 / 5);
+        best = std::min(best, elapsed / (calls * ops));
+    }
+    return BenchResult{name, best, ops};
+}
+
+static std::vector<BenchResult> run_all(double min_ms, const char* filter) {
+    std::vector<BenchResult> results;
+    auto want = [&](const char* name) {
+        return filter == nullptr || strstr(name, filter) != nullptr;
+    };
+    block seed = makeBlock(0x6D6963726F62656EULL, 0x6368000000000000ULL);
+    PRG prg(&seed);
+    NullIO io;
+
+    if (want("prg_random_data")) {
+        std::vector<block> buf(1 << 16);
+        results.push_back(run_bench("prg_random_data", buf.size(), min_ms, [&]() {
+            prg.random_data(buf.data(), (int)(buf.size() * sizeof(block)));
+        }));
+    }
+
+    if (want("prg_random_bool")) {
+        std::vector<uint8_t> flags(1 << 16);
+        results.push_back(run_bench("prg_random_bool", flags.size(), min_ms, [&]() {
+            prg.random_bool((bool*)flags.data(), (int)flags.size());
+        }));
+    }
+
+    if (want("prp_expand_level")) {
+        // One 2^12 -> 2^13 GGM level
+        const int parents = 1 << 12;
+        std::vector<block> tree(2 * parents);
+        prg.random_block(tree.data(), parents);
+        TwoKeyPRP_Blake3 prp(zero_block, makeBlock(0, 1));
+        results.push_back(run_bench("prp_expand_level", parents, min_ms, [&]() {
+            prp.expand_level(tree.data(), parents);
+        }));
+    }
+
+    const int lpn_n = 1 << 16, lpn_k = 1 << 14;
+    if (want("lpn_compute_send") || want("lpn_compute_recv") ||
+        want("lpn_compute_send_u64") || want("lpn_compute_recv_soa")) {
+        ThreadPool pool(1);
+        LpnFpBlake3<10> lpn(lpn_n, lpn_k, &pool, pool.size(), seed);
+        std::vector<__uint128_t> pre(lpn_k), out(lpn_n);
+        for (int i = 0; i < lpn_k; ++i) {
+            uint64_t v[2];
+            prg.random_data(v, sizeof(v));
+            pre[i] = ((__uint128_t)mod(v[1]) << 64) | mod(v[0]);
+        }
+        if (want("lpn_compute_send"))
+            results.push_back(run_bench("lpn_compute_send", lpn_n, min_ms, [&]() {
+                lpn.compute_send(out.data(), pre.data());
+            }));
+        if (want("lpn_compute_recv"))
+            results.push_back(run_bench("lpn_compute_recv", lpn_n, min_ms, [&]() {
+                lpn.compute_recv(out.data(), pre.data());
+            }));
+        // Compact sender storage, same values
+        std::vector<uint64_t> pre64(pre.begin(), pre.end()), out64(lpn_n);
+        if (want("lpn_compute_send_u64"))
+            results.push_back(run_bench("lpn_compute_send_u64", lpn_n, min_ms, [&]() {
+                lpn.compute_send(out64.data(), pre64.data());
+            }));
+        // Split receiver storage, same values: x words, then z words
+        std::vector<uint64_t> pre_x(lpn_k), out_z(lpn_n);
+        for (int i = 0; i < lpn_k; ++i)
+            pre_x[i] = (uint64_t)(pre[i] >> 64);
+        if (want("lpn_compute_recv_soa"))
+            results.push_back(run_bench("lpn_compute_recv_soa", lpn_n, min_ms, [&]() {
+                lpn.compute_recv(out64.data(), out_z.data(), pre_x.data(), pre64.data());
+            }));
+    }
+
+    // Receiver LPN at lower row weights, same n and k as above
+    auto lpn_weight = [&](const char* name, auto weight) {
+        if (!want(name))
+            return;
+        ThreadPool pool(1);
+        LpnFpBlake3<decltype(weight)::value> lpn(lpn_n, lpn_k, &pool, pool.size(), seed);
+        std::vector<__uint128_t> pre(lpn_k), out(lpn_n);
+        for (auto& p : pre) {
+            uint64_t v[2];
+            prg.random_data(v, sizeof(v));
+            p = ((__uint128_t)mod(v[1]) << 64) | mod(v[0]);
+        }
+        results.push_back(run_bench(name, lpn_n, min_ms, [&]() {
+            lpn.compute_recv(out.data(), pre.data());
+        }));
+    };
+    lpn_weight("lpn_compute_recv_d7", std::integral_constant<int, 7>());
+    lpn_weight("lpn_compute_recv_d8", std::integral_constant<int, 8>());
+
+    // Dual-LPN compression of a rate-1/2 code (bins of 2^10) into lpn_n
+    // outputs; the accumulate pass rewrites the z words in place, which
+    // keeps them reduced
+    if (want("ea_encode_recv")) {
+        ThreadPool pool(1);
+        const int ea_t = (2 * lpn_n) >> 10;
+        EaCodeFpBlake3<10> ea(lpn_n, ea_t, 10, &pool, pool.size(), seed);
+        std::vector<uint64_t> noise(ea.code_n), beta(ea_t);
+        std::vector<int64_t> at(ea_t);
+        std::vector<__uint128_t> out(lpn_n);
+        prg.random_data(noise.data(), noise.size() * sizeof(uint64_t));
+        prg.random_data(beta.data(), beta.size() * sizeof(uint64_t));
+        for (auto& e : noise)
+            e = mod(e);
+        for (int b = 0; b < ea_t; ++b) {
+            beta[b] = mod(beta[b]);
+            at[b] = ((int64_t)b << 10) + (beta[b] & 1023);
+        }
+        results.push_back(run_bench("ea_encode_recv", lpn_n, min_ms, [&]() {
+            ea.encode_recv(out.data(), noise.data(), at.data(), beta.data());
+        }));
+    }
+
+    // OT pre-processing for 256 trees of depth 13
+    const int ot_len = 12, ot_trees = 256, ot_n = ot_len * ot_trees;
+    if (want("otpre_send_pre") || want("otpre_recv_pre") || want("otpre_send") ||
+        want("otpre_recv")) {
+        OTPre<NullIO> ot(&io, ot_len, ot_trees);
+        std::vector<block> data(ot_n), m0(ot_len), m1(ot_len), got(ot_len);
+        std::vector<uint8_t> choice_bytes(ot_n);
+        prg.random_block(data.data(), ot_n);
+        prg.random_block(m0.data(), ot_len);
+        prg.random_block(m1.data(), ot_len);
+        prg.random_data(choice_bytes.data(), ot_n);
+        bool* choices = new bool[ot_n];
+        for (int i = 0; i < ot_n; ++i)
+            choices[i] = choice_bytes[i] & 1;
+        if (want("otpre_send_pre"))
+            results.push_back(run_bench("otpre_send_pre", ot_n, min_ms, [&]() {
+                ot.send_pre(data.data(), makeBlock(0, 3));
+            }));
+        if (want("otpre_recv_pre"))
+            results.push_back(run_bench("otpre_recv_pre", ot_n, min_ms, [&]() {
+                ot.recv_pre(data.data(), choices);
+            }));
+        if (want("otpre_send"))
+            results.push_back(run_bench("otpre_send", ot_n, min_ms, [&]() {
+                for (int s = 0; s < ot_trees; ++s)
+                    ot.send(m0.data(), m1.data(), ot_len, &io, s);
+            }));
+        if (want("otpre_recv"))
+            results.push_back(run_bench("otpre_recv", ot_n, min_ms, [&]() {
+                for (int s = 0; s < ot_trees; ++s)
+                    ot.recv(got.data(), choices + s * ot_len, ot_len, &io, s);
+            }));
+        delete[] choices;
+        if (io.sink == 0x5EED)
+            printf("(unlikely checksum)\n");
+    }
+
+    // Choice-bit packing for the OTPre choice message
+    const int bits_n = 1 << 16;
+    if (want("pack_bits") || want("unpack_bits")) {
+        std::vector<uint8_t> bytes(bits_n), packed(packed_bytes(bits_n));
+        prg.random_data(bytes.data(), bits_n);
+        bool* flags = new bool[bits_n];
+        for (int i = 0; i < bits_n; ++i)
+            flags[i] = bytes[i] & 1;
+        if (want("pack_bits"))
+            results.push_back(run_bench("pack_bits", bits_n, min_ms, [&]() {
+                pack_bits(packed.data(), flags, bits_n);
+            }));
+        if (want("unpack_bits"))
+            results.push_back(run_bench("unpack_bits", bits_n, min_ms, [&]() {
+                unpack_bits(flags, packed.data(), bits_n);
+            }));
+        delete[] flags;
+    }
+
+    const int vec_n = 1 << 12;
+    if (want("mult_mod")) {
+        std::vector<uint64_t> a(vec_n), b(vec_n), res(vec_n);
+        prg.random_data(a.data(), vec_n * sizeof(uint64_t));
+        prg.random_data(b.data(), vec_n * sizeof(uint64_t));
+        for (int i = 0; i < vec_n; ++i) {
+            a[i] = mod(a[i]);
+            b[i] = mod(b[i]);
+        }
+        results.push_back(run_bench("mult_mod", vec_n, min_ms, [&]() {
+            for (int i = 0; i < vec_n; ++i)
+                res[i] = mult_mod(a[i], b[i]);
+        }));
+    }
+    if (want("vec_mod")) {
+        std::vector<block> v(vec_n), res(vec_n);
+        prg.random_block(v.data(), vec_n);
+        results.push_back(run_bench("vec_mod", vec_n, min_ms, [&]() {
+            for (int i = 0; i < vec_n; ++i)
+                res[i] = vec_mod(v[i]);
+        }));
+    }
+
+    if (want("spfss_recv_compute")) {
+        // Depth-13 tree (4096 leaves), OT messages from the PRG
+        SpfssRecverFpBlake3<NullIO> recver(&io, 13);
+        prg.random_block(recver.m, recver.levels());
+        recver.get_index();
+        std::vector<__uint128_t> tree(recver.leaves());
+        __uint128_t delta2 = ((__uint128_t)mod(7) << 64) | mod(11);
+        results.push_back(run_bench("spfss_recv_compute", recver.leaves(), min_ms, [&]() {
+            recver.compute(tree.data(), delta2);
+        }));
+    }
+
+    // Whole depth-13 GGM trees, per leaf, with both tree expansions
+    if (want("ggm_tree_gen") || want("ggm_tree_gen_half")) {
+        std::vector<__uint128_t> tree(1 << 12);
+        __uint128_t secret = mod(5), gamma = mod(9);
+        if (want("ggm_tree_gen")) {
+            SpfssSenderFpBlake3<NullIO> sender(&io, 13);
+            results.push_back(run_bench("ggm_tree_gen", tree.size(), min_ms, [&]() {
+                sender.compute(tree.data(), secret, gamma);
+            }));
+        }
+        if (want("ggm_tree_gen_half")) {
+            SpfssSenderFpBlake3<NullIO, 0, HalfTreePRP_Blake3> sender(&io, 13);
+            results.push_back(run_bench("ggm_tree_gen_half", tree.size(), min_ms, [&]() {
+                sender.compute(tree.data(), secret, gamma);
+            }));
+        }
+    }
+    return results;
+}
+
+static std::string to_json(const std::vector<BenchResult>& results) {
+    std::string s;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "{\n  \"cpu\": \"%s\",\n  \"blake3_lanes\": %d,\n  \"benchmarks\": [\n",
+             fp61_level_name(fp61_cpu_level()), blake3_batch_lanes());
+    s += buf;
+    for (size_t i = 0; i < results.size(); ++i) {
+        snprintf(buf, sizeof(buf), "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops\": %lld}%s\n",
+                 results[i].name.c_str(), results[i].ns_per_op, (long long)results[i].ops,
+                 i + 1 < results.size() ? "," : "");
+        s += buf;
+    }
+    s += "  ]\n}\n";
+    return s;
+}
+
+// Reads {"name": ..., "ns_per_op": ...} pairs from a file written by --out
+static bool read_baseline(const char* path, std::vector<BenchResult>& base) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr)
+        return false;
+    std::string text;
+    char chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        text.append(chunk, got);
+    fclose(f);
+    size_t pos = 0;
+    while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+        size_t q0 = text.find('"', text.find(':', pos));
+        size_t q1 = text.find('"', q0 + 1);
+        size_t ns = text.find("\"ns_per_op\"", q1);
+        if (q0 == std::string::npos || q1 == std::string::npos || ns == std::string::npos)
+            break;
+        BenchResult r;
+        r.name = text.substr(q0 + 1, q1 - q0 - 1);
+        r.ns_per_op = atof(text.c_str() + text.find(':', ns) + 1);
+        r.ops = 0;
+        base.push_back(r);
+        pos = ns;
+    }
+    return true;
+}
+
+// Prints current vs baseline; returns the number of regressions beyond
+// tolerance (0.25 = 25% slower)
+static int compare(const std::vector<BenchResult>& results,
+                   const std::vector<BenchResult>& base, double tolerance) {
+    int regressions = 0;
+    printf("\n%-20s %12s %12s %8s\n", "benchmark", "baseline", "current", "change");
+    for (const BenchResult& r : results) {
+        const BenchResult* b = nullptr;
+        for (const BenchResult& x : base)
+            if (x.name == r.name)
+                b = &x;
+        if (b == nullptr) {
+            printf("%-20s %12s %12.3f %8s\n", r.name.c_str(), "-", r.ns_per_op, "new");
+            continue;
+        }
+        double change = r.ns_per_op / b->ns_per_op - 1;
+        bool bad = change > tolerance;
+        regressions += bad;
+        printf("%-20s %12.3f %12.3f %+7.1f%%%s\n", r.name.c_str(), b->ns_per_op,
+               r.ns_per_op, 100 * change, bad ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    // --json prints JSON instead of a table, --out FILE also writes it (a new
+    // baseline), --baseline FILE [--tolerance T] fails on regressions beyond
+    // T (fraction, default 0.25), --quick shortens every run, --filter S
+    // runs the benchmarks whose name contains S
+    bool json = false;
+    double min_ms = 500, tolerance = 0.25;
+    const char* out_path = nullptr;
+    const char* baseline_path = nullptr;
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--quick") == 0)
+            min_ms = 10;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baseline_path = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else
+            error("usage: vole_microbench [--json] [--quick] [--out FILE] "
+                  "[--baseline FILE [--tolerance T]] [--filter S]");
+    }
+
+    std::vector<BenchResult> base;
+    if (baseline_path != nullptr && !read_baseline(baseline_path, base))
+        error("Cannot read baseline file");
+
+    std::vector<BenchResult> results = run_all(min_ms, filter);
+    std::string js = to_json(results);
+    if (json) {
+        printf("%s", js.c_str());
+    } else {
+        printf("CPU dispatch: %s kernels, %d BLAKE3 lanes\n\n",
+               fp61_level_name(fp61_cpu_level()), blake3_batch_lanes());
+        printf("%-20s %12s %10s\n", "benchmark", "ns/op", "ops/call");
+        for (const BenchResult& r : results)
+            printf("%-20s %12.3f %10lld\n", r.name.c_str(), r.ns_per_op, (long long)r.ops);
+    }
+    if (out_path != nullptr) {
+        FILE* f = fopen(out_path, "w");
+        if (f == nullptr || fwrite(js.data(), 1, js.size(), f) != js.size())
+            error("Cannot write output file");
+        fclose(f);
+    }
+    if (baseline_path != nullptr) {
+        int regressions = compare(results, base, tolerance);
+        printf("%d regression%s beyond %.0f%%\n", regressions, regressions == 1 ? "" : "s",
+               100 * tolerance);
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
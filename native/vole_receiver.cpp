@@ -3,36 +3,45 @@
 
 #include <cstdio>
 #include <chrono>
+#include <sys/resource.h>
 
 #include "../emp-zk/emp-vole/emp-vole-portable.h"
+#include "../emp-zk/emp-vole/transcript_io.h"
 
 using namespace emp;
 
-int main(int argc, char** argv) {
-    const char* sender_ip = "127.0.0.1";
-    int port = 12345;
-    if (argc > 1) sender_ip = argv[1];
-    if (argc > 2) port = atoi(argv[2]);
-
-    printf("\n========================================\n");
-    printf("VOLE Receiver (Bob)\n");
-    printf("========================================\n\n");
-
-    // Receiver connects to sender
-    NetIO io(sender_ip, port);
-    NetIO* ios[1] = {&io};
+// Peak resident set size of this process in MB
+static double peak_rss_mb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss / 1024.0;
+}
 
+// Setup plus one extend round; VoleT selects the runtime or the
+// compile-time parameter path. seeded fixes the receiver randomness so the
+// session can be recorded and replayed; fs selects Fiat-Shamir MPFSS checks,
+// resume reconnects and resumes the session when the connection drops.
+template <typename VoleT, typename IO>
+static void run_protocol(IO** ios, const char* profile, bool seeded, bool fs,
+                         bool resume) {
     printf("--- Setup Phase ---\n");
     auto setup_start = std::chrono::high_resolution_clock::now();
 
-    VoleTripleBlake3<NetIO> vole(BOB, 1, ios);
+    VoleT vole(BOB, 1, ios, VoleT::profile_param(profile));
+    const PrimalLPNParameterFp61Blake3& prm = vole.param;
+    if (seeded)
+        vole.set_seed(VOLE_TRANSCRIPT_SEED);
+    if (resume)
+        vole.set_resumable();
+    if (fs)
+        vole.set_fiat_shamir();
     vole.setup();
 
     auto setup_end = std::chrono::high_resolution_clock::now();
     auto setup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(setup_end - setup_start).count();
     printf("Setup time: %lld ms\n", (long long)setup_ms);
-    printf("  Stage 0: 1821 base -> 9600\n");
-    printf("  Stage 1: 9600 -> 166400\n\n");
+    printf("  Stage 0: %lld base -> %lld\n", (long long)prm.base_voles(), (long long)prm.n_pre0);
+    printf("  Stage 1: %lld -> %lld\n\n", (long long)prm.n_pre0, (long long)prm.n_pre);
 
     // Extend
     printf("--- Extension Phase ---\n");
@@ -43,10 +52,11 @@ int main(int argc, char** argv) {
 
     auto extend_start = std::chrono::high_resolution_clock::now();
     vole.extend(voles.data());
+    vole.finish();
     auto extend_end = std::chrono::high_resolution_clock::now();
     auto extend_ms = std::chrono::duration_cast<std::chrono::milliseconds>(extend_end - extend_start).count();
 
-    printf("  Final: 166400 -> 10168320\n");
+    printf("  Final: %lld -> %lld\n", (long long)prm.n_pre, (long long)prm.n);
     printf("Extension time: %lld ms\n\n", (long long)extend_ms);
 
     double rate = (double)output_size / ((setup_ms + extend_ms) / 1000.0);
@@ -57,13 +67,107 @@ int main(int argc, char** argv) {
     printf("Total time:      %lld ms\n", (long long)(setup_ms + extend_ms));
     printf("VOLEs generated: %lld\n", (long long)output_size);
     printf("Rate: %.2f million VOLEs/sec\n", rate / 1e6);
+    printf("Extend rate:     %.2f million VOLEs/sec\n",
+           (double)output_size / (std::max<long long>(extend_ms, 1) / 1000.0) / 1e6);
+    printf("Peak memory:     %.1f MB\n", peak_rss_mb());
+    if (resume)
+        printf("Reconnects:      %lld (%.1f ms max recovery)\n",
+               (long long)vole.resume_stats.drops, vole.resume_stats.recover_max_ms);
     printf("========================================\n\n");
+    vole.print_stats();
+}
 
-    io.print_stats();
+// Runs the receiver over io with the runtime or compile-time parameters;
+// trace_path, if set, receives the session timeline
+template <typename IO>
+static void run_receiver(IO* io, const char* profile, bool fixed, bool seeded,
+                         bool fs, bool resume, const char* trace_path) {
+    IO* ios[1] = {io};
+    printf("Profile: %s (%s parameters)\n", profile, fixed ? "compile-time" : "runtime");
+    printf("CPU dispatch: %s kernels, %d BLAKE3 lanes\n\n",
+           fp61_level_name(fp61_cpu_level()), blake3_batch_lanes());
+    if (fixed) {
+        if (!with_fixed_profile_fp61(profile, [&](auto p) {
+                run_protocol<VoleTripleBlake3<IO, decltype(p)>>(ios, profile, seeded, fs, resume);
+            }))
+            error("No compile-time parameter set for this profile");
+    } else {
+        run_protocol<VoleTripleBlake3<IO>>(ios, profile, seeded, fs, resume);
+    }
+
+    io->print_stats();
+    if (trace_path != nullptr && !vole_trace_dump(trace_path))
+        error("Cannot write trace file");
 
     printf("\n--- Mock Statistics ---\n");
-    printf("Base COTs:   %lld\n", (long long)BaseCotMock<NetIO>::total_cots);
-    printf("Base VOLEs:  %lld\n", (long long)Base_svole_direct_mock<NetIO>::total_base_voles);
+    printf("Base COTs:   %lld\n", (long long)BaseCotMock<IO>::total_cots);
+    printf("Base VOLEs:  %lld\n", (long long)Base_svole_direct_mock<IO>::total_base_voles);
+}
+
+int main(int argc, char** argv) {
+    // --fixed selects the compile-time specialised pipeline; --record FILE
+    // saves the session transcript, --replay FILE runs against one without
+    // a sender; --trace FILE writes a Chrome trace-event timeline; --fs uses
+    // Fiat-Shamir MPFSS checks, like the sender (also needed to replay a
+    // transcript recorded with it); --resume reconnects to the sender and
+    // resumes the session when the connection drops, like the sender
+    bool fixed = false, fs = false, resume = false;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    const char* trace_path = nullptr;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fixed") == 0)
+            fixed = true;
+        else if (strcmp(argv[i], "--fs") == 0)
+            fs = true;
+        else if (strcmp(argv[i], "--resume") == 0)
+            resume = true;
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_path = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+
+    const char* sender_ip = "127.0.0.1";
+    int port = 12345;
+    if (args.size() > 0) sender_ip = args[0];
+    if (args.size() > 1) port = atoi(args[1]);
+    const char* profile = "default";
+    if (args.size() > 2) profile = args[2];
+    if (trace_path != nullptr)
+        vole_trace_start();
+
+    printf("\n========================================\n");
+    printf("VOLE Receiver (Bob)\n");
+    printf("========================================\n\n");
+
+    if (resume && (record_path != nullptr || replay_path != nullptr))
+        error("--resume needs a live connection, not a transcript");
+
+    if (replay_path != nullptr) {
+        // Profile comes from the transcript header
+        ReplayIO io(replay_path);
+        std::string replay_profile = io.profile();
+        printf("Replaying %s\n", replay_path);
+        run_receiver(&io, replay_profile.c_str(), fixed, true, fs, false, trace_path);
+        if (!io.finished())
+            error("Replay ended before the end of the transcript");
+        return 0;
+    }
+
+    // Receiver connects to sender
+    NetIO net(sender_ip, port);
+    if (record_path != nullptr) {
+        RecordIO<NetIO> io(&net, record_path, profile);
+        run_receiver(&io, profile, fixed, true, fs, false, trace_path);
+    } else {
+        run_receiver(&net, profile, fixed, false, fs, resume, trace_path);
+    }
 
     return 0;
 }
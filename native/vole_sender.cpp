@@ -3,48 +3,66 @@
 
 #include <cstdio>
 #include <chrono>
+#include <sys/resource.h>
 
 #include "../emp-zk/emp-vole/emp-vole-portable.h"
 
 using namespace emp;
 
-int main(int argc, char** argv) {
-    int port = 12345;
-    if (argc > 1) port = atoi(argv[1]);
-
-    printf("\n========================================\n");
-    printf("VOLE Sender (Alice)\n");
-    printf("========================================\n\n");
-
-    // Sender listens for receiver connection
-    NetIO io(nullptr, port);
-    NetIO* ios[1] = {&io};
+// Peak resident set size of this process in MB
+static double peak_rss_mb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss / 1024.0;
+}
 
+// Setup plus one extend round; VoleT selects the runtime or the
+// compile-time parameter path, fs the Fiat-Shamir MPFSS checks, compact
+// the packed 64-bit output storage, resume a reconnecting session
+template <typename VoleT>
+static void run_protocol(NetIO** ios, const char* profile, bool fs, bool compact,
+                         bool resume) {
     printf("--- Setup Phase ---\n");
     auto setup_start = std::chrono::high_resolution_clock::now();
 
-    VoleTripleBlake3<NetIO> vole(ALICE, 1, ios);
+    VoleT vole(ALICE, 1, ios, VoleT::profile_param(profile));
+    const PrimalLPNParameterFp61Blake3& prm = vole.param;
+    if (fs)
+        vole.set_fiat_shamir();
+    if (compact)
+        vole.set_compact_sender();
+    if (resume)
+        vole.set_resumable();
     vole.setup();
 
     auto setup_end = std::chrono::high_resolution_clock::now();
     auto setup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(setup_end - setup_start).count();
     printf("Setup time: %lld ms\n", (long long)setup_ms);
-    printf("  Stage 0: 1821 base -> 9600\n");
-    printf("  Stage 1: 9600 -> 166400\n\n");
+    printf("  Stage 0: %lld base -> %lld\n", (long long)prm.base_voles(), (long long)prm.n_pre0);
+    printf("  Stage 1: %lld -> %lld\n\n", (long long)prm.n_pre0, (long long)prm.n_pre);
 
     // Extend
     printf("--- Extension Phase ---\n");
     int64_t output_size = vole.param.buf_sz();
     printf("Target: %lld VOLEs\n", (long long)output_size);
 
-    std::vector<__uint128_t> voles(vole.param.n);
+    std::vector<__uint128_t> voles;
+    std::vector<uint64_t> voles64;
+    if (compact)
+        voles64.resize(vole.param.n);
+    else
+        voles.resize(vole.param.n);
 
     auto extend_start = std::chrono::high_resolution_clock::now();
-    vole.extend(voles.data());
+    if (compact)
+        vole.extend(voles64.data());
+    else
+        vole.extend(voles.data());
+    vole.finish();
     auto extend_end = std::chrono::high_resolution_clock::now();
     auto extend_ms = std::chrono::duration_cast<std::chrono::milliseconds>(extend_end - extend_start).count();
 
-    printf("  Final: 166400 -> 10168320\n");
+    printf("  Final: %lld -> %lld\n", (long long)prm.n_pre, (long long)prm.n);
     printf("Extension time: %lld ms\n\n", (long long)extend_ms);
 
     double rate = (double)output_size / ((setup_ms + extend_ms) / 1000.0);
@@ -55,9 +73,72 @@ int main(int argc, char** argv) {
     printf("Total time:      %lld ms\n", (long long)(setup_ms + extend_ms));
     printf("VOLEs generated: %lld\n", (long long)output_size);
     printf("Rate: %.2f million VOLEs/sec\n", rate / 1e6);
+    printf("Extend rate:     %.2f million VOLEs/sec\n",
+           (double)output_size / (std::max<long long>(extend_ms, 1) / 1000.0) / 1e6);
+    printf("Peak memory:     %.1f MB\n", peak_rss_mb());
+    if (resume)
+        printf("Reconnects:      %lld (%.1f ms max recovery)\n",
+               (long long)vole.resume_stats.drops, vole.resume_stats.recover_max_ms);
     printf("========================================\n\n");
+    vole.print_stats();
+}
+
+int main(int argc, char** argv) {
+    // --fixed selects the compile-time specialised pipeline; --trace FILE
+    // writes a Chrome trace-event timeline of the session; --fs uses
+    // Fiat-Shamir MPFSS checks (the receiver must pass it too); --compact
+    // keeps the outputs as packed 64-bit words (sender-local); --resume
+    // accepts the receiver again and resumes the session when the
+    // connection drops (the receiver must pass it too)
+    bool fixed = false, fs = false, compact = false, resume = false;
+    const char* trace_path = nullptr;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fixed") == 0)
+            fixed = true;
+        else if (strcmp(argv[i], "--fs") == 0)
+            fs = true;
+        else if (strcmp(argv[i], "--compact") == 0)
+            compact = true;
+        else if (strcmp(argv[i], "--resume") == 0)
+            resume = true;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+
+    int port = 12345;
+    const char* profile = "default";
+    if (args.size() > 0) port = atoi(args[0]);
+    if (args.size() > 1) profile = args[1];
+    if (trace_path != nullptr)
+        vole_trace_start();
+
+    printf("\n========================================\n");
+    printf("VOLE Sender (Alice)\n");
+    printf("========================================\n\n");
+
+    // Sender listens for receiver connection
+    NetIO io(nullptr, port);
+    NetIO* ios[1] = {&io};
+
+    printf("Profile: %s (%s parameters%s)\n", profile, fixed ? "compile-time" : "runtime",
+           compact ? ", 64-bit outputs" : "");
+    printf("CPU dispatch: %s kernels, %d BLAKE3 lanes\n\n",
+           fp61_level_name(fp61_cpu_level()), blake3_batch_lanes());
+    if (fixed) {
+        if (!with_fixed_profile_fp61(profile, [&](auto p) {
+                run_protocol<VoleTripleBlake3<NetIO, decltype(p)>>(ios, profile, fs, compact, resume);
+            }))
+            error("No compile-time parameter set for this profile");
+    } else {
+        run_protocol<VoleTripleBlake3<NetIO>>(ios, profile, fs, compact, resume);
+    }
 
     io.print_stats();
+    if (trace_path != nullptr && !vole_trace_dump(trace_path))
+        error("Cannot write trace file");
 
     printf("\n--- Mock Statistics ---\n");
     printf("Base COTs:   %lld\n", (long long)BaseCotMock<NetIO>::total_cots);
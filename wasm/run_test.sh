@@ -21,7 +21,7 @@ echo ""
 # Start native sender
 echo "1. Starting native sender (Alice) on port 12345..."
 cd ../native/build
-./vole_sender 12345 &
+./vole_sender 12345 "${PROFILE:-default}" &
 SENDER_PID=$!
 cd ../../wasm
 sleep 1
@@ -3,12 +3,15 @@
 
 #include <cstdio>
 #include <chrono>
+#include <string>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
 
 #include "../emp-zk/emp-vole/emp-vole-portable.h"
+#include "../emp-zk/emp-vole/vole_chunk_pool.h"
+#include "../emp-zk/emp-vole/transcript_io.h"
 
 using namespace emp;
 
@@ -16,12 +19,61 @@ using namespace emp;
 
 extern "C" {
 
+// Hands a finished trace to Module.onVoleTrace(json), if the page set one
+EM_JS(void, vole_trace_emit, (const char* json), {
+    if (Module.onVoleTrace) Module.onVoleTrace(UTF8ToString(json));
+});
+
+// Records a timeline of the next vole_run calls with capacity events per
+// thread (vole_trace.h); 0 turns tracing off
+EMSCRIPTEN_KEEPALIVE
+void vole_trace_enable(int capacity) {
+    if (capacity > 0)
+        vole_trace_start(capacity);
+    else
+        vole_trace_stop();
+}
+
+// The LPN set behind a profile name or "select:TARGET:BUDGET_MB" spec, as
+// {"n":..,"t":..,"k":..,"voles_per_round":..,"receiver_bytes":..} with the
+// receiver's working set from lpn_memory_fp61, or {"error":..}. The string
+// stays valid until the next call.
 EMSCRIPTEN_KEEPALIVE
-int vole_run(const char* server_ip, int port) {
+const char* vole_profile_info(const char* profile) {
+    static std::string result;
+    PrimalLPNParameterFp61Blake3 prm;
+    if (!lpn_param_lookup_fp61(profile, &prm)) {
+        result = "{\"error\":\"unknown profile or no set within the budget\"}";
+        return result.c_str();
+    }
+    char buf[192];
+    snprintf(buf, sizeof(buf),
+             "{\"n\":%lld,\"t\":%lld,\"k\":%lld,\"voles_per_round\":%lld,\"receiver_bytes\":%lld}",
+             (long long)prm.n, (long long)prm.t, (long long)prm.k, (long long)prm.buf_sz(),
+             (long long)lpn_memory_fp61(prm));
+    result = buf;
+    return result.c_str();
+}
+
+// Runs setup plus one extend and returns a JSON summary for JS:
+// {"profile":..,"setup_ms":..,"extend_ms":..,"voles":..,"stats":{"setup":
+// {..},"extend":{..}}} with the per-phase stats of vole_stats.h, or
+// {"error":..}. The string stays valid until the next call.
+EMSCRIPTEN_KEEPALIVE
+const char* vole_run(const char* server_ip, int port, const char* profile) {
+    static std::string result;
     printf("\n========================================\n");
     printf("VOLE WASM Receiver (Bob)\n");
     printf("========================================\n\n");
 
+    PrimalLPNParameterFp61Blake3 prm_check;
+    if (!lpn_param_lookup_fp61(profile, &prm_check)) {
+        printf("Unknown parameter profile: %s\n", profile);
+        result = "{\"error\":\"unknown profile\"}";
+        return result.c_str();
+    }
+    printf("Profile: %s\n\n", profile);
+
     // Create IO array (VoleTripleBlake3 expects IO**)
     // NetIO in WASM mode uses WebSocket
     NetIO io(server_ip, port);
@@ -30,14 +82,15 @@ int vole_run(const char* server_ip, int port) {
     printf("--- Setup Phase ---\n");
     auto setup_start = std::chrono::high_resolution_clock::now();
 
-    VoleTripleBlake3<NetIO> vole(BOB, 1, ios);
+    VoleTripleBlake3<NetIO> vole(BOB, 1, ios, profile);
+    const PrimalLPNParameterFp61Blake3& prm = vole.param;
     vole.setup();
 
     auto setup_end = std::chrono::high_resolution_clock::now();
     auto setup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(setup_end - setup_start).count();
     printf("Setup time: %lld ms\n", (long long)setup_ms);
-    printf("  Stage 0: 1821 base -> 9600\n");
-    printf("  Stage 1: 9600 -> 166400\n\n");
+    printf("  Stage 0: %lld base -> %lld\n", (long long)prm.base_voles(), (long long)prm.n_pre0);
+    printf("  Stage 1: %lld -> %lld\n\n", (long long)prm.n_pre0, (long long)prm.n_pre);
 
     // Extend
     printf("--- Extension Phase ---\n");
@@ -51,7 +104,7 @@ int vole_run(const char* server_ip, int port) {
     auto extend_end = std::chrono::high_resolution_clock::now();
     auto extend_ms = std::chrono::duration_cast<std::chrono::milliseconds>(extend_end - extend_start).count();
 
-    printf("  Final: 166400 -> 10168320\n");
+    printf("  Final: %lld -> %lld\n", (long long)prm.n_pre, (long long)prm.n);
     printf("Extension time: %lld ms\n\n", (long long)extend_ms);
 
     double rate = (double)output_size / ((setup_ms + extend_ms) / 1000.0);
@@ -64,18 +117,128 @@ int vole_run(const char* server_ip, int port) {
     printf("Rate: %.2f million VOLEs/sec\n", rate / 1e6);
     printf("========================================\n\n");
 
+    vole.print_stats();
     io.print_stats();
+    if (vole_trace_on())
+        vole_trace_emit(vole_trace_json().c_str());
 
     printf("\n--- Mock Statistics ---\n");
     printf("Base COTs:   %lld\n", (long long)BaseCotMock<NetIO>::total_cots);
     printf("Base VOLEs:  %lld\n", (long long)Base_svole_direct_mock<NetIO>::total_base_voles);
 
+    char head[160];
+    snprintf(head, sizeof(head),
+             "{\"profile\":\"%s\",\"setup_ms\":%lld,\"extend_ms\":%lld,\"voles\":%lld,\"stats\":",
+             profile, (long long)setup_ms, (long long)extend_ms, (long long)output_size);
+    result = head + vole.stats_json() + "}";
+    return result.c_str();
+}
+
+// Receiver-only benchmark: replays a transcript recorded by
+// `vole_receiver --record` (data/len point at a copy in the WASM heap) for
+// `rounds` sessions. Returns the total setup + extend time in ms, or -1 if
+// the transcript names an unknown profile.
+EMSCRIPTEN_KEEPALIVE
+int vole_replay(const uint8_t* data, int len, int rounds) {
+    ReplayIO io(data, len);
+    std::string profile = io.profile();
+    PrimalLPNParameterFp61Blake3 prm;
+    if (!lpn_param_lookup_fp61(profile.c_str(), &prm)) return -1;
+    ReplayIO* ios[1] = {&io};
+
+    long long total_ms = 0;
+    for (int r = 0; r < rounds; ++r) {
+        io.rewind();
+        auto start = std::chrono::high_resolution_clock::now();
+        VoleTripleBlake3<ReplayIO> vole(BOB, 1, ios, profile.c_str());
+        vole.set_seed(VOLE_TRANSCRIPT_SEED);
+        vole.setup();
+        std::vector<__uint128_t> voles(vole.param.n);
+        vole.extend(voles.data());
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        printf("Replay %d (%s): %lld ms\n", r, profile.c_str(), ms);
+        total_ms += ms;
+    }
+    return (int)total_ms;
+}
+
+// Streaming session: JS leases VOLE chunks and reads them through
+// BigUint64Array views over the WASM heap (no copy across the boundary).
+// The session is a split receiver, so each lease extends straight into its
+// chunk's z and x halves. Views are invalidated when the heap grows, so JS must rebuild them after
+// every lease call.
+static NetIO* session_io = nullptr;
+static NetIO* session_ios[1];
+static VoleTripleBlake3<NetIO>* session_vole = nullptr;
+static VoleChunkPool<VoleTripleBlake3<NetIO>>* session_pool = nullptr;
+
+// Ends the session. A resumable one closes with finish(), which talks to
+// the sender, so JS must call it with Module.ccall(..., {async: true}).
+// finish() needs the sender to have run as many rounds: vole_sender
+// --resume runs one, so a resumable stream against it leases exactly one
+// round before closing.
+EMSCRIPTEN_KEEPALIVE
+void vole_session_close() {
+    if (session_vole != nullptr)
+        session_vole->finish();
+    delete session_pool;
+    delete session_vole;
+    delete session_io;
+    session_pool = nullptr;
+    session_vole = nullptr;
+    session_io = nullptr;
+}
+
+// resumable: reconnect and resume the session when the WebSocket drops
+// (the sender must run with --resume)
+EMSCRIPTEN_KEEPALIVE
+int vole_session_open(const char* server_ip, int port, const char* profile,
+                      int resumable) {
+    vole_session_close();
+    PrimalLPNParameterFp61Blake3 prm;
+    if (!lpn_param_lookup_fp61(profile, &prm)) return -1;
+    session_io = new NetIO(server_ip, port);
+    session_ios[0] = session_io;
+    session_vole = new VoleTripleBlake3<NetIO>(BOB, 1, session_ios, profile);
+    if (resumable)
+        session_vole->set_resumable();
+    session_vole->set_soa_receiver();
+    session_vole->setup();
+    session_pool = new VoleChunkPool<VoleTripleBlake3<NetIO>>(session_vole);
     return 0;
 }
 
+// Returns a chunk id, or -1 if no session is open
+EMSCRIPTEN_KEEPALIVE
+int vole_chunk_lease(int count) {
+    if (session_pool == nullptr) return -1;
+    return session_pool->lease(count);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void vole_chunk_release(int id) {
+    if (session_pool != nullptr) session_pool->release(id);
+}
+
+EMSCRIPTEN_KEEPALIVE
+const uint64_t* vole_chunk_x(int id) {
+    return session_pool ? session_pool->x(id) : nullptr;
+}
+
+EMSCRIPTEN_KEEPALIVE
+const uint64_t* vole_chunk_z(int id) {
+    return session_pool ? session_pool->z(id) : nullptr;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int vole_chunk_size(int id) {
+    return session_pool ? (int)session_pool->size(id) : 0;
+}
+
 int main() {
     printf("VOLE WASM Receiver module loaded.\n");
-    printf("Call vole_run('localhost', 8080) to connect to sender via WebSocket proxy.\n");
+    printf("Call vole_run('localhost', 8080, 'default') to connect to sender via WebSocket proxy.\n");
     return 0;
 }
 